@@ -0,0 +1,87 @@
+#pragma once
+
+#include "sdcard.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// RAM budget for the asset cache, set to 0 to disable it
+#ifndef ASSET_CACHE_BUDGET
+#define ASSET_CACHE_BUDGET (12 * 1024)
+#endif
+
+// Keeps small, frequently requested files in RAM so they can be served without touching the SD card.
+// An entry is compared against the size and modification time of its file at most once per REVALIDATE_INTERVAL_MS,
+// so a file replaced on the card is picked up without reading the card on every request.
+class AssetCache {
+public:
+  static constexpr std::size_t MAX_ENTRIES              = 8;
+  static constexpr std::size_t MAX_PATH_LEN             = 48;
+  static constexpr std::uint32_t REVALIDATE_INTERVAL_MS = 2000;
+  static constexpr const char* MANIFEST_PATH            = "/www/cache-manifest.txt";
+
+  struct Entry {
+    std::uint32_t pathHash;
+    char path[MAX_PATH_LEN];
+    const char* contentType;
+    std::unique_ptr<std::uint8_t[]> data;
+    std::size_t size;
+    std::uint32_t modified;   // SDCardFile::modifiedDateTime() of the file the data was read from
+    std::uint32_t checkedAt;  // millis() when the file was last compared against the data
+    std::uint32_t lastUsed;
+    std::uint8_t readers;  // In-flight responses reading the data, the entry can't be evicted while this is non-zero
+    bool pinned;
+    bool stale;   // The file changed while responses were still reading the data, freed by the last release()
+    bool reload;  // Pinned and stale, the file is read again by find() once the old data has been freed
+  };
+
+  struct Stats {
+    std::uint32_t hits;
+    std::uint32_t misses;
+    std::uint32_t insertions;
+    std::uint32_t evictions;
+    std::uint32_t invalidations;  // Entries dropped because their file changed or disappeared
+    std::size_t bytesUsed;
+    std::size_t entryCount;
+  };
+
+  AssetCache(std::size_t budget = ASSET_CACHE_BUDGET);
+
+  bool enabled() const { return _budget > 0; }
+
+  // Looks up a path and refreshes its LRU position, counts a hit or a miss.
+  // An entry whose file changed is dropped and counted as a miss, unless it was pinned, then it is reloaded,
+  // after the responses still reading the old data have released it
+  const Entry* find(const char* path, SDCard& sd);
+
+  // Reads the whole file into the cache, evicting unpinned entries as needed. File position is not restored
+  const Entry* insert(const char* path, const char* contentType, SDCardFile& file, bool pinned = false);
+
+  // Keeps an entry alive while a response is still being streamed from it
+  void retain(const Entry& entry) { _entries[&entry - _entries].readers++; }
+  void release(const Entry& entry);
+
+  // Pins every path listed in the manifest file, one path per line
+  std::size_t loadManifest(SDCard& sd);
+
+  const Stats& stats() const { return _stats; }
+
+  AssetCache(const AssetCache&)            = delete;
+  AssetCache& operator=(const AssetCache&) = delete;
+
+private:
+  static std::uint32_t _hashPath(const char* path);
+
+  Entry* _findEntry(const char* path, std::uint32_t pathHash);
+  Entry* _findReload(const char* path, std::uint32_t pathHash);
+  bool _revalidate(Entry& entry, SDCard& sd);
+  bool _reloadPinned(const char* path, std::uint32_t pathHash, SDCard& sd);
+  Entry* _reserve(std::size_t size);
+  void _evict(Entry& entry);
+
+  Entry _entries[MAX_ENTRIES];
+  std::size_t _budget;
+  std::uint32_t _tick;
+  Stats _stats;
+};
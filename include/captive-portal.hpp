@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ESP8266WebServer.h>
+
+#include <cstdint>
+
+// Answers OS connectivity probes from flash, so joining phones never hit the SD card
+class CaptivePortalHandler : public RequestHandler {
+  using WebServerType = esp8266webserver::ESP8266WebServerTemplate<WiFiServer>;
+
+public:
+  enum class ProbeResponse : std::uint8_t {
+    NoContent,  // 204, Android and ChromeOS
+    Success,    // 200 with the body the OS expects when it is online
+    Redirect,   // Always redirected to the portal
+  };
+
+  struct ProbeRoute {
+    const char* path;         // PROGMEM
+    ProbeResponse response;
+    const char* contentType;  // PROGMEM, only used by ProbeResponse::Success
+    const char* body;         // PROGMEM, only used by ProbeResponse::Success
+  };
+
+  CaptivePortalHandler();
+
+  bool canHandle(HTTPMethod method, const String& uri) override;
+  bool handle(WebServerType& server, HTTPMethod requestMethod, const String& requestUri) override;
+
+  // When enabled, probes are redirected to the portal so the OS opens its sign-in page,
+  // otherwise they get the response the OS expects from a working internet connection
+  void setRedirectEnabled(bool enabled) { _redirectEnabled = enabled; }
+  bool redirectEnabled() const { return _redirectEnabled; }
+
+  std::uint32_t probeCount() const { return _probeCount; }
+
+  CaptivePortalHandler(CaptivePortalHandler const&) = delete;
+  void operator=(CaptivePortalHandler const&)       = delete;
+
+private:
+  static const ProbeRoute* _findRoute(const String& uri);
+
+  bool _redirectEnabled;
+  std::uint32_t _probeCount;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "serializers/collar-protocol.hpp"
+
+#include <cstdint>
+
+enum class CollarAction : std::uint8_t {
+  Transmit = 0,
+  Stop     = 1,
+  Pattern  = 2,
+};
+
+// A decoded client request, independent of the wire format it arrived in
+struct CollarCommand {
+  CollarAction action;
+  std::uint16_t transmitterId;
+  Channel channel;
+  Command command;
+  std::uint8_t strength;
+  std::uint16_t durationMs;
+};
+
+enum class KeyframeShape : std::uint8_t {
+  Hold  = 0,  // Constant strength
+  Ramp  = 1,  // Strength moves linearly from the previous keyframe's strength, 0 for the first keyframe
+  Pause = 2,  // Nothing is transmitted, command and strength are ignored
+
+  _Min = Hold,
+  _Max = Pause
+};
+
+// One step of an intensity pattern
+struct CollarKeyframe {
+  KeyframeShape shape;
+  Command command;
+  std::uint8_t strength;
+  std::uint16_t durationMs;
+};
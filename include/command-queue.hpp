@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ws-protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Sits between the WebSocket callbacks and command execution.
+// Every client has a token bucket for stimulus commands and a cap on how many it may have queued, so a flooding client
+// only delays itself. Stop commands are never rate limited and are always executed before queued stimulus commands,
+// but a client may only have a few of them queued, so it can't take every stop slot or keep cancelling other clients.
+class CommandQueue {
+public:
+  static constexpr std::size_t CAPACITY             = 8;  // Stimulus commands
+  static constexpr std::size_t STOP_CAPACITY        = 8;
+  static constexpr std::size_t MAX_PER_CLIENT       = 2;
+  static constexpr std::size_t MAX_STOPS_PER_CLIENT = 2;
+  static constexpr std::uint8_t NO_CLIENT           = UINT8_MAX;  // Client of a stop whose sender disconnected
+  static constexpr std::uint8_t BUCKET_SIZE         = 5;
+  static constexpr std::uint32_t TOKEN_INTERVAL_MS  = 100;
+
+  enum class Admission : std::uint8_t {
+    Queued,
+    RateLimited,
+    QueueFull,
+  };
+
+  struct Entry {
+    std::uint8_t clientId;
+    bool binary;  // Wire format of the request, the ack is sent back in the same format
+    std::uint32_t arrivalMicros;
+    WsProtocol::Message message;
+  };
+
+  struct Stats {
+    std::uint32_t queued;
+    std::uint32_t droppedRateLimited;
+    std::uint32_t droppedQueueFull;
+    std::uint32_t droppedPreempted;  // Stimulus commands cancelled by a stop for the same collar
+    std::uint32_t droppedDisconnected;
+    std::size_t depth;
+    std::size_t maxDepth;
+  };
+
+  CommandQueue();
+
+  Admission push(const Entry& entry, std::uint32_t now);
+
+  // Takes a token for a stimulus command that is executed right away instead of being queued, like a pattern.
+  // Returns false if the client is rate limited
+  bool admit(std::uint8_t clientId, std::uint32_t now);
+
+  // Takes the next command to execute, stops first. A stop from a client that has since disconnected has NO_CLIENT as
+  // its client and must not be acknowledged, the socket id may already belong to someone else
+  bool pop(Entry& entry);
+
+  // Drops the pending stimulus commands of a client and refills its bucket. Its stops are still executed, without an ack
+  void removeClient(std::uint8_t clientId);
+
+  std::size_t depth() const { return _stops.count + _commands.count; }
+  const Stats& stats() const { return _stats; }
+
+private:
+  template<std::size_t N>
+  struct Ring {
+    Entry entries[N];
+    std::size_t head;
+    std::size_t count;
+
+    Entry& at(std::size_t i) { return entries[(head + i) % N]; }
+    bool full() const { return count == N; }
+    void push(const Entry& entry) { entries[(head + count++) % N] = entry; }
+    void pop(Entry& entry) {
+      entry = entries[head];
+      head  = (head + 1) % N;
+      count--;
+    }
+  };
+
+  struct Bucket {
+    std::uint8_t tokens;
+    std::uint8_t pending;
+    std::uint8_t stops;
+    std::uint32_t lastRefill;
+  };
+
+  bool _takeToken(Bucket& bucket, std::uint32_t now);
+
+  // Removes queued stimulus commands matching the predicate, keeping the order of the rest
+  template<typename Predicate>
+  std::size_t _removeCommands(Predicate predicate);
+
+  void _updateDepth();
+
+  Ring<STOP_CAPACITY> _stops;
+  Ring<CAPACITY> _commands;
+  Bucket _buckets[WEBSOCKETS_SERVER_CLIENT_MAX];
+  Stats _stats;
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <ArduinoJson.h>
+
+// MessagePack documents in files encrypted with CryptoFileReader/CryptoFileWriter, used for everything under /config
+bool ReadEncryptedMsgPackFile(const char* name, DynamicJsonDocument& doc);
+bool WriteEncryptedMsgPackFile(const char* name, const DynamicJsonDocument& doc);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct HttpRange {
+  std::size_t start;
+  std::size_t length;
+
+  constexpr std::size_t last() const { return start + length - 1; }
+};
+
+// Parsed "Range: bytes=..." request header, resolved against a file size (RFC 7233)
+class HttpRangeSet {
+public:
+  static constexpr std::size_t MAX_RANGES = 8;
+
+  enum class ParseResult {
+    None,           // No header, malformed header or too many ranges, serve the full file
+    Satisfiable,    // At least one range overlaps the file
+    Unsatisfiable,  // Well-formed, but no range overlaps the file, respond with 416
+  };
+
+  HttpRangeSet() : _ranges(), _count(0) { }
+
+  ParseResult parse(const char* header, std::size_t fileSize);
+
+  std::size_t count() const { return _count; }
+  const HttpRange& operator[](std::size_t index) const { return _ranges[index]; }
+
+  const HttpRange* begin() const { return _ranges; }
+  const HttpRange* end() const { return _ranges + _count; }
+
+private:
+  HttpRange _ranges[MAX_RANGES];
+  std::size_t _count;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "asset-cache.hpp"
+#include "http-range.hpp"
+#include "sdcard.hpp"
+
+#include <WiFiClient.h>
+
+#include <cstdint>
+
+// A response body that is written to its client a little at a time, so one slow download can't block other clients.
+// Headers are sent by the web server beforehand, the transfer only produces the body.
+class HttpTransfer {
+public:
+  static constexpr std::size_t SD_SECTOR_SIZE     = 512;
+  static constexpr std::uint32_t STALL_TIMEOUT_MS = 5000;
+  static constexpr const char* MULTIPART_TYPE     = "multipart/byteranges; boundary=ZAPME_BYTERANGES";
+
+  enum class State : std::uint8_t {
+    Idle,
+    PartHeader,
+    Body,
+    Footer,
+    Done,
+    Failed,
+  };
+
+  HttpTransfer();
+
+  // Sends the whole source if ranges is empty, a single range as-is, or multiple ranges as multipart/byteranges
+  void begin(const WiFiClient& client, SDCardFile&& file, const char* contentType, const HttpRangeSet& ranges);
+  void begin(const WiFiClient& client, const AssetCache::Entry& entry, const HttpRangeSet& ranges);
+
+  // Writes as much as the client can take without blocking, at most one chunk. Returns false once the transfer is over
+  bool pump(std::uint8_t* buffer, std::size_t chunkSize);
+
+  // Releases the client and the file, the transfer slot can be reused afterwards
+  void reset();
+
+  // Content-Length of a multipart/byteranges body for the given ranges
+  static std::size_t MultipartLength(const char* contentType, std::size_t size, const HttpRangeSet& ranges);
+
+  bool active() const { return _state != State::Idle && _state != State::Done && _state != State::Failed; }
+  bool idle() const { return _state == State::Idle; }
+  State state() const { return _state; }
+
+  const AssetCache::Entry* cacheEntry() const { return _entry; }
+  std::size_t bytesSent() const { return _bytesSent; }
+  std::uint32_t startMicros() const { return _startMicros; }
+  std::uint32_t busyMicros() const { return _busyMicros; }
+  std::uint32_t maxStepMicros() const { return _maxStepMicros; }
+
+  HttpTransfer(const HttpTransfer&)            = delete;
+  HttpTransfer& operator=(const HttpTransfer&) = delete;
+
+private:
+  void _start(const WiFiClient& client, const char* contentType, std::size_t size, const HttpRangeSet& ranges);
+  bool _enterRange(std::size_t index);
+  bool _writeText(const char* text, std::size_t length, std::size_t writable);
+  bool _writeBody(std::uint8_t* buffer, std::size_t chunkSize, std::size_t writable);
+
+  WiFiClient _client;
+  SDCardFile _file;
+  const AssetCache::Entry* _entry;
+  HttpRangeSet _ranges;
+  const char* _contentType;
+  std::size_t _size;
+  std::size_t _rangeIndex;
+  std::size_t _position;
+  std::size_t _remaining;
+  std::size_t _bytesSent;
+  std::uint32_t _startMicros;
+  std::uint32_t _busyMicros;
+  std::uint32_t _maxStepMicros;
+  std::uint32_t _lastProgressMillis;
+  State _state;
+};
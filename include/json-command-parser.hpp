@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ws-protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// In-place parser for JSON command messages, a fixed schema replaces the generic document model:
+//   {"op":"cmd","seq":1,"id":4660,"ch":0,"cmd":"shock","str":50,"dur":1000}
+//   {"op":"stop","seq":2,"id":4660,"ch":0}
+//   {"op":"sub","seq":3} / {"op":"unsub","seq":4}
+// Only flat objects with unsigned integer or short string values are accepted, unknown keys,
+// oversize values and anything nested are rejected as soon as they are seen. Nothing is allocated.
+// "v" is optional, any value but WsProtocol::VERSION is answered with UnsupportedVersion.
+class JsonCommandParser {
+  JsonCommandParser() = delete;
+
+public:
+  static constexpr std::size_t MAX_MESSAGE_SIZE = 192;
+  static constexpr std::size_t MAX_KEY_LEN      = 8;
+  static constexpr std::size_t MAX_STRING_LEN   = 16;
+  static constexpr std::size_t MAX_ACK_SIZE     = 40;
+
+  static WsProtocol::Status Parse(const char* data, std::size_t length, WsProtocol::Message& message);
+
+  // Writes {"ack":<seq>,"status":<status>} and returns its length
+  static std::size_t EncodeAck(std::uint16_t sequence, WsProtocol::Status status, char* buffer, std::size_t size);
+};
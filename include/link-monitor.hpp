@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Measures WebSocket round-trip times with timestamped pings and notices clients that went silent.
+// Every client keeps a small fixed-bucket histogram, percentiles are reported as the upper bound of their bucket.
+class LinkMonitor {
+public:
+  static constexpr std::uint32_t PING_INTERVAL_MS   = 2000;
+  static constexpr std::uint32_t SILENCE_TIMEOUT_MS = 10'000;
+  static constexpr std::uint16_t REPORT_INTERVAL    = 5;  // Pongs between reports to the client
+  static constexpr std::size_t PING_PAYLOAD_SIZE    = 4;
+
+  static constexpr std::size_t BUCKET_COUNT                       = 10;
+  static constexpr std::uint16_t BUCKET_BOUNDS_MS[BUCKET_COUNT - 1] = {2, 5, 10, 20, 50, 100, 200, 500, 1000};
+
+  struct Report {
+    std::uint16_t lastMs;
+    std::uint16_t p50Ms;
+    std::uint16_t p99Ms;
+    std::uint16_t samples;
+  };
+
+  // Clients to ping or disconnect, one bit per client ID
+  struct Actions {
+    std::uint32_t ping;
+    std::uint32_t drop;
+  };
+
+  LinkMonitor();
+
+  void connect(std::uint8_t clientId, std::uint32_t now);
+  void disconnect(std::uint8_t clientId);
+
+  // Any traffic from the client counts as a sign of life
+  void heard(std::uint8_t clientId, std::uint32_t now);
+
+  void update(std::uint32_t now, Actions& actions);
+
+  // Fills the payload of the next ping
+  void encodePing(std::uint8_t* payload, std::uint32_t nowMicros) const;
+
+  // Records the RTT of a pong carrying one of our ping payloads, returns true when a report is due for the client
+  bool pong(std::uint8_t clientId, const std::uint8_t* payload, std::size_t length, std::uint32_t nowMicros, std::uint32_t now);
+
+  Report report(std::uint8_t clientId) const;
+
+private:
+  struct Client {
+    bool connected;
+    std::uint32_t lastHeard;
+    std::uint32_t lastPing;
+    std::uint16_t lastMs;
+    std::uint16_t maxMs;
+    std::uint16_t pongsSinceReport;
+    std::uint16_t samples;
+    std::uint16_t counts[BUCKET_COUNT];
+  };
+
+  static std::uint16_t _percentile(const Client& client, std::uint32_t permille);
+
+  Client _clients[WEBSOCKETS_SERVER_CLIENT_MAX];
+};
@@ -6,6 +6,8 @@
 #include <cstdarg>
 #include <cstdint>
 
+class NtpClient;
+
 class Logger {
   Logger() = delete;
 
@@ -18,6 +20,9 @@ public:
 
   static InitializationError Initialize();
 
+  // Lines are stamped with the clock's UTC time while it's valid, with the uptime otherwise
+  static void SetClock(const NtpClient* clock);
+
   static void vprintlnf(const char* format, va_list args);
   static void printlnf(const char* format, ...);
   static void println(const String& message);
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct MimeTypeEntry {
+  const char* extension;
+  const char* mimeType;
+};
+
+// Manifest of known file extensions, add new entries here.
+// Extensions are lowercase and without the leading dot, lookups are case-insensitive.
+static constexpr MimeTypeEntry MIME_TYPES[] = {
+  { "html",                "text/html"},
+  {  "htm",                "text/html"},
+  {  "css",                 "text/css"},
+  {   "js",   "application/javascript"},
+  {  "mjs",   "application/javascript"},
+  {  "png",                "image/png"},
+  {  "jpg",               "image/jpeg"},
+  { "jpeg",               "image/jpeg"},
+  {  "gif",                "image/gif"},
+  {  "ico",             "image/x-icon"},
+  {  "svg",            "image/svg+xml"},
+  { "webp",               "image/webp"},
+  {  "ttf",                 "font/ttf"},
+  { "woff",                "font/woff"},
+  {"woff2",               "font/woff2"},
+  {  "otf",                 "font/otf"},
+  {  "txt",               "text/plain"},
+  {  "log",               "text/plain"},
+  { "json",         "application/json"},
+  {  "pdf",          "application/pdf"},
+  {  "bin", "application/octet-stream"},
+  {   "gz",         "application/gzip"},
+};
+
+static constexpr std::size_t MIME_TYPE_COUNT            = sizeof(MIME_TYPES) / sizeof(MimeTypeEntry);
+static constexpr std::size_t MIME_EXTENSION_MAX_LEN     = 8;
+static constexpr const char* MIME_TYPE_DEFAULT          = "application/octet-stream";
+static constexpr std::size_t MIME_HASH_TABLE_SIZE       = 64;
+static constexpr std::uint32_t MIME_HASH_MAX_SEED_TRIES = 100'000;
+
+static_assert(MIME_TYPE_COUNT < 0xFF, "MIME manifest too large for 8-bit slot indices");
+static_assert(MIME_HASH_TABLE_SIZE >= MIME_TYPE_COUNT * 2, "MIME hash table must be at least twice the manifest size");
+static_assert((MIME_HASH_TABLE_SIZE & (MIME_HASH_TABLE_SIZE - 1)) == 0, "MIME hash table size must be a power of two");
+
+class MimeTypes {
+  MimeTypes() = delete;
+
+public:
+  // Returns the MIME type for the extension (with or without leading dot), or nullptr if unknown
+  static constexpr const char* Find(const char* extension);
+
+  // Same as Find, but falls back to application/octet-stream
+  static constexpr const char* Get(const char* extension) {
+    const char* mimeType = Find(extension);
+    return mimeType != nullptr ? mimeType : MIME_TYPE_DEFAULT;
+  }
+
+  static constexpr char ToLower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c; }
+
+  // FNV-1a over the lowercased extension, mixed with a seed chosen at compile time so the manifest hashes without collisions
+  static constexpr std::uint32_t Hash(const char* extension, std::uint32_t seed) {
+    std::uint32_t hash = 2'166'136'261U ^ seed;
+    for (std::size_t i = 0; extension[i] != '\0'; ++i) {
+      hash ^= static_cast<std::uint8_t>(ToLower(extension[i]));
+      hash *= 16'777'619U;
+    }
+    hash ^= hash >> 15;
+    return hash;
+  }
+
+  static constexpr std::size_t Slot(const char* extension, std::uint32_t seed) {
+    return Hash(extension, seed) & (MIME_HASH_TABLE_SIZE - 1);
+  }
+
+  static constexpr bool EqualsIgnoreCase(const char* lowered, const char* other) {
+    std::size_t i = 0;
+    for (; lowered[i] != '\0'; ++i) {
+      if (lowered[i] != ToLower(other[i])) {
+        return false;
+      }
+    }
+    return other[i] == '\0';
+  }
+
+  static constexpr std::uint32_t FindSeed() {
+    for (std::uint32_t seed = 0; seed < MIME_HASH_MAX_SEED_TRIES; ++seed) {
+      bool used[MIME_HASH_TABLE_SIZE] {};
+      bool collision = false;
+      for (std::size_t i = 0; i < MIME_TYPE_COUNT && !collision; ++i) {
+        std::size_t slot = Slot(MIME_TYPES[i].extension, seed);
+        collision        = used[slot];
+        used[slot]       = true;
+      }
+      if (!collision) {
+        return seed;
+      }
+    }
+    return MIME_HASH_MAX_SEED_TRIES;
+  }
+
+  // Slot -> manifest index + 1, 0 marks an empty slot
+  static constexpr std::array<std::uint8_t, MIME_HASH_TABLE_SIZE> BuildTable(std::uint32_t seed) {
+    std::array<std::uint8_t, MIME_HASH_TABLE_SIZE> table {};
+    for (std::size_t i = 0; i < MIME_TYPE_COUNT; ++i) {
+      table[Slot(MIME_TYPES[i].extension, seed)] = static_cast<std::uint8_t>(i + 1);
+    }
+    return table;
+  }
+};
+
+static constexpr std::uint32_t MIME_HASH_SEED = MimeTypes::FindSeed();
+static_assert(MIME_HASH_SEED < MIME_HASH_MAX_SEED_TRIES, "No collision-free seed found for the MIME manifest, grow the table");
+
+static constexpr std::array<std::uint8_t, MIME_HASH_TABLE_SIZE> MIME_HASH_TABLE = MimeTypes::BuildTable(MIME_HASH_SEED);
+
+constexpr const char* MimeTypes::Find(const char* extension) {
+  if (extension == nullptr) {
+    return nullptr;
+  }
+  if (extension[0] == '.') {
+    ++extension;
+  }
+
+  // Reject empty and overlong extensions before hashing
+  std::size_t length = 0;
+  while (extension[length] != '\0') {
+    if (++length > MIME_EXTENSION_MAX_LEN) {
+      return nullptr;
+    }
+  }
+  if (length == 0) {
+    return nullptr;
+  }
+
+  std::uint8_t index = MIME_HASH_TABLE[Slot(extension, MIME_HASH_SEED)];
+  if (index == 0) {
+    return nullptr;
+  }
+
+  const MimeTypeEntry& entry = MIME_TYPES[index - 1];
+  if (!EqualsIgnoreCase(entry.extension, extension)) {
+    return nullptr;
+  }
+
+  return entry.mimeType;
+}
+
+static_assert(MimeTypes::Find(".HTML") == MIME_TYPES[0].mimeType, "MIME lookup must be case-insensitive");
+static_assert(MimeTypes::Find("exe") == nullptr, "Unknown extensions must not match");
@@ -5,31 +5,127 @@
 #include <cstdint>
 #include <ctime>
 
+// SNTP client (RFC 4330). Every reply gives the four exchange timestamps, the round trip delay is removed from the
+// server's time and the result anchors a mapping from the local micros64() clock to the epoch. The local oscillator's
+// rate error is measured across syncs at least NTP_DRIFT_INTERVAL_SECONDS apart and applied between syncs.
+// Reading the time is arithmetic on that mapping, no network access.
+// Until the first sync every server is asked at once and the reply with the shortest round trip wins. After that
+// one server is asked per interval, the one with the best score from its round trip, stratum and recent losses.
+// Every few requests the others are probed in turn, so a recovered server can win back its place.
+// Server names are resolved asynchronously through lwIP and refreshed hourly, nothing here blocks loop().
+// A server that fails is backed off exponentially and the next one is asked right away.
+// The mapping is kept in RTC memory, which survives everything but a power cycle. After a warm reset restore() carries
+// it across the reset with the RTC clock, so the time is known from boot with an uncertainty that the next sync settles.
 class NtpClient {
-  static constexpr std::size_t NTP_PORT                    = 123;
-  static constexpr std::size_t NTP_PACKET_SIZE             = 48;
-  static constexpr std::size_t NTP_UPDATE_INTERVAL_SECONDS = 30;
+  static constexpr std::uint16_t NTP_PORT                     = 123;
+  static constexpr std::size_t NTP_PACKET_SIZE                = 48;
+  static constexpr std::size_t NTP_UPDATE_INTERVAL_SECONDS    = 30;
+  static constexpr std::uint32_t NTP_RESPONSE_TIMEOUT_MS      = 2000;
+  static constexpr std::uint32_t NTP_MAX_DELAY_MS             = 1000;     // Samples with a longer round trip are dropped
+  static constexpr std::uint32_t NTP_MAX_SYNC_AGE_SECONDS     = 600;      // Time is reported valid this long after a sync
+  static constexpr std::uint32_t NTP_DRIFT_INTERVAL_SECONDS   = 600;      // Shortest baseline for a drift measurement
+  static constexpr std::int32_t NTP_MAX_DRIFT_PPB             = 500'000;  // Larger measurements are treated as bad samples
+  static constexpr std::uint32_t NTP_BACKOFF_MIN_SECONDS      = 4;
+  static constexpr std::uint32_t NTP_BACKOFF_MAX_SECONDS      = 1024;
+  static constexpr std::uint32_t NTP_STRATUM_PENALTY_US       = 5000;    // Per stratum level below 1
+  static constexpr std::uint32_t NTP_LOSS_PENALTY_US          = 20'000;  // Per recent loss
+  static constexpr std::uint32_t NTP_PROBE_EVERY              = 8;       // Every nth request goes round-robin
+  static constexpr std::uint32_t NTP_RESOLVE_INTERVAL_SECONDS = 3600;
+  static constexpr std::uint32_t NTP_RESOLVE_RETRY_SECONDS    = 30;
+  static constexpr std::uint32_t NTP_MAX_UNCERTAINTY_MS       = 500;         // Time is reported valid only within this bound
+  static constexpr std::int32_t NTP_CRYSTAL_ERROR_PPB         = 100'000;     // Rate error before drift is measured
+  static constexpr std::int32_t NTP_DRIFT_ERROR_PPB           = 10'000;      // Rate error left after correction
+  static constexpr std::int32_t NTP_RTC_ERROR_PPB             = 20'000'000;  // The RTC clock runs off an RC oscillator
+  static constexpr std::uint32_t NTP_SAVE_INTERVAL_MS         = 1000;
+  static constexpr std::uint32_t NTP_MAX_RESTORE_GAP_SECONDS  = 3600;  // The RTC tick counter wraps after about 6 h
+  static constexpr std::uint32_t NTP_RTC_BLOCK                = 32;    // The first 128 bytes belong to the OTA bootloader
+
+  static constexpr std::uint64_t NTP_UNIX_EPOCH_OFFSET = 2'208'988'800ULL;  // 1900-01-01 to 1970-01-01
 
 public:
+  static constexpr std::size_t MAX_SERVERS = 4;
+
+  struct ServerStats {
+    std::uint32_t roundTripMicros;  // Last measured, 0 until the server has answered
+    std::uint32_t losses;           // Requests that timed out or got an unusable reply
+    std::uint8_t recentLosses;      // Halved on every reply, part of the score
+    std::uint8_t failures;          // Consecutive, sets the backoff
+    std::uint32_t replies;
+    std::uint8_t stratum;
+  };
+
   NtpClient();
   ~NtpClient();
 
   bool begin();
   void end();
 
+  // Takes over the clock saved before a warm reset, fails after a power cycle or if the state is unusable
+  bool restore();
+
   void update();
 
   bool isTimeValid() const;
   time_t getEpochTime() const;
+  std::uint64_t getEpochMillis() const;
+
+  // Epoch time of a micros64() reading, 0 before the first sync
+  std::uint64_t toEpochMicros(std::uint64_t localMicros) const;
+
+  // Bound on the error of the time right now, grows with the time since the last sync
+  std::uint32_t getUncertaintyMicros() const;
+
+  std::uint32_t getRoundTripMicros() const { return _roundTripMicros; }
+  std::int32_t getDriftPpb() const { return _driftPpb; }
+
+  const char* getServerName(std::size_t index) const;
+  const ServerStats& getServerStats(std::size_t index) const { return _servers[index].stats; }
 
 private:
+  // One point on the local -> epoch mapping, both in microseconds
+  struct Anchor {
+    std::uint64_t localMicros;
+    std::uint64_t epochMicros;
+  };
+
+  struct Server {
+    ServerStats stats;
+    std::uint64_t requestMicros;  // micros64() when the pending request was sent, 0 if none is pending
+    std::uint32_t retryAt;        // millis() until which a failing server is skipped
+  };
+
   WiFiUDP _udp;
   std::uint8_t _buffer[NTP_PACKET_SIZE];
-  std::size_t _serverIndex;
-  std::uint64_t _lastTransmit;
-  std::uint64_t _lastReceive;
-  time_t _epochTime;
+  Server _servers[MAX_SERVERS];
+  std::uint32_t _nextRequest;
+  bool _bursting;
+  std::uint32_t _burstRoundTrip;  // Shortest round trip applied during the burst
+  std::uint32_t _requests;
+  std::size_t _probeIndex;
+  bool _synced;
+  bool _restored;  // The anchor came from before a reset, there's no local baseline for drift yet
+  Anchor _anchor;
+  std::uint32_t _anchorUncertainty;
+  std::uint64_t _syncEpochMicros;
+  std::uint32_t _nextSave;
+  Anchor _driftReference;
+  std::int32_t _driftPpb;
+  std::uint32_t _roundTripMicros;
 
-  void sendNtpPacket();
+  void sendNtpPacket(std::size_t index);
   bool handleNtpPacket();
+  void applySample(const Anchor& sample, std::size_t index);
+  void save();
+
+  void resolveServers(std::uint32_t now);
+  void startLookup(std::size_t index, std::uint32_t now);
+
+  bool isPending() const;
+  std::size_t selectServer(std::uint32_t now);
+  std::uint32_t score(std::size_t index) const;
+  void fail(std::size_t index, std::uint32_t now, const char* reason);
+
+  static std::uint64_t ReadTimestamp(const std::uint8_t* data);
+  static void WriteTimestamp(std::uint8_t* data, std::uint64_t timestamp);
+  static std::uint64_t TimestampToEpochMicros(std::uint64_t timestamp);
 };
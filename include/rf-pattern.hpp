@@ -0,0 +1,74 @@
+#pragma once
+
+#include "collar-command.hpp"
+#include "serializers/caixianlin-protocol.hpp"
+#include "serializers/collar-protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// An intensity pattern for one collar, compiled from keyframes into the frames it will put on air.
+// Everything is encoded up front, playing it back is a lookup by the time elapsed since the pattern started,
+// so the timing depends only on the device clock and late polls never push the rest of the pattern back.
+// A ramp starts from the last keyframe that isn't a pause and gets one frame per strength step, but no more than fit
+// in its duration. Keyframes shorter than a frame may be skipped entirely when the radio is busy.
+class RfPattern {
+public:
+  static constexpr std::size_t MAX_KEYFRAMES     = 16;
+  static constexpr std::size_t MAX_FRAMES        = 128;
+  static constexpr std::uint32_t MAX_DURATION_MS = 60'000;  // Also ends a pattern that repeats until stopped
+
+  using Protocol = CollarProtocol<CaiXianlinProtocol>;
+  using Frame    = Protocol::Frame;
+
+  static constexpr std::uint32_t FRAME_MS = Protocol::FRAME_US / 1000;
+
+  RfPattern();
+
+  // Encodes the pattern, loops 0 repeats it until stopped or MAX_DURATION_MS has passed. Fails if a keyframe is invalid,
+  // the first one is a pause, the frames don't fit, or the loops take longer than MAX_DURATION_MS. A failed compile
+  // leaves the pattern empty
+  bool compile(std::uint16_t transmitterId,
+               Channel channel,
+               const CollarKeyframe* keyframes,
+               std::size_t count,
+               std::uint8_t loops);
+  void clear();
+
+  bool empty() const { return _keyframeCount == 0; }
+  std::uint16_t transmitterId() const { return _transmitterId; }
+  Channel channel() const { return _channel; }
+  std::size_t keyframeCount() const { return _keyframeCount; }
+  std::size_t frameCount() const { return _frameCount; }
+
+  // Length of one pass, and of the whole pattern
+  std::uint32_t periodMs() const { return _periodMs; }
+  std::uint32_t durationMs() const { return _loops != 0 ? _periodMs * _loops : MAX_DURATION_MS; }
+
+  bool finished(std::uint32_t elapsedMs) const { return elapsedMs >= durationMs(); }
+
+  // Keyframe due at the time since the pattern started, MAX_KEYFRAMES once finished
+  std::size_t keyframeAt(std::uint32_t elapsedMs) const;
+  std::uint32_t keyframeStartMs(std::size_t index) const { return _segments[index].startMs; }
+  bool isPause(std::size_t index) const { return _segments[index].frameCount == 0; }
+
+  // Frame due at the time since the pattern started, nullptr during a pause or once finished
+  const Frame* frameAt(std::uint32_t elapsedMs) const;
+
+private:
+  struct Segment {
+    std::uint32_t startMs;  // Offset within one pass
+    std::uint16_t durationMs;
+    std::uint8_t firstFrame;
+    std::uint8_t frameCount;  // 0 for a pause
+  };
+
+  Segment _segments[MAX_KEYFRAMES];
+  Frame _frames[MAX_FRAMES];
+  std::size_t _keyframeCount;
+  std::size_t _frameCount;
+  std::uint32_t _periodMs;
+  std::uint16_t _transmitterId;
+  Channel _channel;
+  std::uint8_t _loops;
+};
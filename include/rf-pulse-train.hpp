@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// On-air timing of a symbol frame. Every bit of a symbol byte is one chip, MSB first, 1 is carrier on.
+// Runs of equal chips are merged into one pulse, so levels alternate starting with carrier on.
+class RfPulseTrain {
+public:
+  static constexpr std::size_t MAX_FRAME_SIZE    = 32;
+  static constexpr std::size_t MAX_PULSES        = MAX_FRAME_SIZE * 8;
+  static constexpr std::uint16_t DEFAULT_CHIP_US = 250;
+
+  RfPulseTrain();
+
+  // Returns false if the frame is empty, too long, or doesn't start with carrier on
+  bool build(const std::byte* frame, std::size_t length, std::uint16_t chipUs = DEFAULT_CHIP_US);
+
+  std::size_t count() const { return _count; }
+  std::uint32_t totalUs() const { return _totalUs; }
+  std::uint16_t durationUs(std::size_t index) const { return _durations[index]; }
+
+private:
+  std::uint16_t _durations[MAX_PULSES];
+  std::size_t _count;
+  std::uint32_t _totalUs;
+};
+
+// Replays a pulse train a number of times with a carrier-off gap in between.
+// Hardware independent, the transmitter's timer interrupt pulls one pulse at a time from it.
+class RfPulsePlayer {
+public:
+  RfPulsePlayer();
+
+  // Inline like next, the transmitter's interrupt starts a queued train with it
+  inline __attribute__((always_inline)) void begin(const RfPulseTrain& train, std::uint16_t repeats, std::uint32_t gapUs) {
+    _active     = false;
+    _train      = &train;
+    _index      = 0;
+    _remaining  = repeats;
+    _gapUs      = gapUs;
+    _gapPending = false;
+    _active     = train.count() > 0 && repeats > 0;
+  }
+  void stop() { _active = false; }
+  bool active() const { return _active; }
+
+  // Returns how long to hold the level, 0 once the transmission is complete
+  inline __attribute__((always_inline)) std::uint32_t next(bool& level) {
+    if (!_active) {
+      return 0;
+    }
+
+    if (_gapPending) {
+      _gapPending = false;
+      level       = false;
+      return _gapUs;
+    }
+
+    if (_index == _train->count()) {
+      if (--_remaining == 0) {
+        _active = false;
+        return 0;
+      }
+      _index = 0;
+    }
+
+    std::size_t index      = _index++;
+    std::uint32_t duration = _train->durationUs(index);
+    level                  = (index & 1) == 0;
+
+    // The gap before the next repeat extends a trailing carrier-off pulse, or follows a trailing carrier-on pulse
+    if (_index == _train->count() && _remaining > 1 && _gapUs > 0) {
+      if (level) {
+        _gapPending = true;
+      } else {
+        duration += _gapUs;
+      }
+    }
+
+    return duration;
+  }
+
+private:
+  const RfPulseTrain* _train;
+  std::size_t _index;
+  std::uint16_t _remaining;
+  std::uint32_t _gapUs;
+  bool _gapPending;
+  volatile bool _active;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "collar-command.hpp"
+#include "rf-pattern.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Shares the radio between several collars, one frame at a time.
+// A new command must get its first frame out before its deadline, the earliest deadline goes first. Once running,
+// targets take turns round-robin until their duration is over, so a long burst on one collar can't starve another.
+// A pattern takes a target like a command, its frames follow the time since its first frame went out.
+// One frame may wait behind the one on air, so the radio can start it the moment the current one ends instead of
+// whenever the caller polls next. Time is passed in by the caller, which keeps the scheduler independent of the
+// hardware clock.
+class RfScheduler {
+public:
+  static constexpr std::size_t MAX_TARGETS = 4;
+  static constexpr std::uint32_t FRAME_MS  = RfPattern::FRAME_MS;
+
+  using Protocol = RfPattern::Protocol;
+  using Frame    = RfPattern::Frame;
+
+  struct Stats {
+    std::uint32_t submitted;
+    std::uint32_t replaced;      // Commands superseded by a newer one for the same collar
+    std::uint32_t rejected;      // Invalid, or no free target
+    std::uint32_t completed;
+    std::uint32_t expired;       // First frame couldn't be sent before the deadline
+    std::uint32_t stopped;
+    std::uint32_t preempted;     // Stops that cut a frame short on air
+    std::uint32_t framesSent;
+    std::uint32_t framesFailed;  // Handed out but refused by the radio, see unsend
+  };
+
+  explicit RfScheduler(std::uint32_t frameMs = FRAME_MS);
+
+  // Schedules a transmit command, replacing the current one for the same collar
+  bool submit(const CollarCommand& command, std::uint32_t now, std::uint32_t deadlineMs);
+
+  // Schedules a compiled pattern for its collar, replacing the current command. The pattern is read while it's
+  // scheduled, it must not be changed or destroyed before it has finished or been stopped
+  bool submit(const RfPattern& pattern, std::uint32_t now, std::uint32_t deadlineMs);
+
+  // Cancels the collar's command. Returns true if its frame is on air or queued and the radio must be stopped
+  bool stop(std::uint16_t transmitterId, Channel channel, std::uint32_t now);
+
+  // Same as stop, but only if the pattern is still what its collar is running
+  bool stop(const RfPattern& pattern, std::uint32_t now);
+
+  // Whether the pattern is still scheduled, it may be reused once it isn't
+  bool scheduled(const RfPattern& pattern) const;
+
+  // Returns the next frame to put on air, or nullptr if one is already waiting behind the frame on air or nothing is
+  // due. The frame is chosen for the time it will start, which is when the frame before it ends
+  const Frame* next(std::uint32_t now);
+
+  // Takes back the frame returned by the last call to next because the radio couldn't send it. It isn't counted as
+  // sent, and a command that was waiting for its first frame goes back to waiting for it
+  void unsend();
+
+  std::size_t activeTargets() const;
+  const Stats& stats() const { return _stats; }
+
+private:
+  // Frames handed to the radio, the last one ends at busyUntil and the previous one a frame earlier
+  struct Radio {
+    std::size_t last;  // Target of the frame, MAX_TARGETS if none
+    std::size_t previous;
+    std::uint32_t busyUntil;
+  };
+
+  struct Target {
+    bool active;
+    bool started;
+    std::uint16_t transmitterId;
+    Channel channel;
+    std::uint32_t deadline;
+    std::uint32_t durationMs;
+    std::uint32_t startTime;
+    std::uint32_t endTime;
+    Frame frame;  // Encoded on submit, unused for a pattern
+    const RfPattern* pattern;
+  };
+
+  static bool _before(std::uint32_t a, std::uint32_t b) { return static_cast<std::int32_t>(a - b) < 0; }
+
+  Target* _find(std::uint16_t transmitterId, Channel channel);
+  Target* _claim(std::uint16_t transmitterId, Channel channel);
+  const Frame* _frameOf(const Target& target, std::uint32_t now) const;
+  bool _cancel(Target& target, std::uint32_t now);
+  void _retire(std::uint32_t now);
+
+  Target _targets[MAX_TARGETS];
+  std::size_t _cursor;
+  Radio _radio;
+  Radio _radioBeforeNext;  // Restored by unsend
+  bool _startedByNext;     // The last frame was its command's first
+  std::uint32_t _frameMs;
+  Stats _stats;
+};
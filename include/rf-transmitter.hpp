@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Plays symbol frames on a GPIO from the timer1 interrupt, so WiFi and SD card work in loop() can't disturb the timing.
+// Timer1 is also used by the core's waveform generator, analogWrite() and tone() can't be used alongside it.
+class RfTransmitter {
+  RfTransmitter() = delete;
+
+public:
+  static constexpr std::uint32_t TIMER_TICKS_PER_US  = 5;   // 80 MHz / 16
+  static constexpr std::uint32_t TIMER_LATENCY_TICKS = 10;  // Interrupt entry to timer write, see test_rf_pulse_train
+  static constexpr std::uint32_t TIMER_MAX_TICKS     = (1UL << 23) - 1;
+
+  // Only GPIO 0..15 can be driven from the interrupt
+  static bool Begin(std::uint8_t pin);
+  static void End();
+
+  // Replaces whatever is being transmitted
+  static bool
+    Transmit(const std::byte* frame, std::size_t length, std::uint16_t chipUs, std::uint16_t repeats, std::uint32_t gapUs);
+
+  // Sends the frame once, right after the current transmission ends. The interrupt starts it, so it follows without a
+  // gap however late loop() runs. Returns false if a frame is already queued, or the frame is invalid
+  static bool Queue(const std::byte* frame, std::size_t length, std::uint16_t chipUs);
+  static bool CanQueue();
+
+  // Also drops the queued frame
+  static void Stop();
+  static bool IsBusy();
+};
@@ -1,21 +1,68 @@
 #pragma once
 
+#include "asset-cache.hpp"
+#include "http-range.hpp"
+#include "http-transfer.hpp"
 #include "sdcard.hpp"
 
 #include <ESP8266WebServer.h>
 
+#include <memory>
+
+// Default number of bytes read from the SD card and written to the client per step, rounded down to whole sectors
+#ifndef SD_STREAM_CHUNK_SIZE
+#define SD_STREAM_CHUNK_SIZE 2048
+#endif
+
 class SDCardWebHandler : public RequestHandler {
   using WebServerType = esp8266webserver::ESP8266WebServerTemplate<WiFiServer>;
 
 public:
+  static constexpr std::size_t SD_SECTOR_SIZE        = HttpTransfer::SD_SECTOR_SIZE;
+  static constexpr std::size_t STREAM_CHUNK_SIZE_MIN = SD_SECTOR_SIZE;
+  static constexpr std::size_t STREAM_CHUNK_SIZE_MAX = 8 * SD_SECTOR_SIZE;
+  static constexpr std::size_t MAX_TRANSFERS         = 4;
+
+  struct StreamStats {
+    std::uint32_t transfers;
+    std::uint32_t failedTransfers;
+    std::uint64_t bytesSent;
+    std::uint64_t busyMicros;   // Time spent reading and writing, during which loop() is stalled
+    std::uint64_t totalMicros;  // Wall time from the request being handled to the last byte being queued
+    std::uint32_t maxChunkMicros;
+    std::uint32_t maxTransferMicros;
+    std::uint8_t activeTransfers;
+    std::uint8_t peakTransfers;
+  };
+
   SDCardWebHandler();
 
   bool canHandle(HTTPMethod method, const String& uri) override;
   bool handle(WebServerType& server, HTTPMethod requestMethod, const String& requestUri) override;
 
+  // Every transfer slot is in use, new requests should be left waiting until update() frees one
+  bool busy() const;
+
+  // Advances every in-flight response by at most one chunk
+  void update();
+
+  const AssetCache::Stats& cacheStats() const { return _cache.stats(); }
+
+  bool setStreamChunkSize(std::size_t size);
+  std::size_t streamChunkSize() const { return _streamChunkSize; }
+  const StreamStats& streamStats() const { return _streamStats; }
+
   SDCardWebHandler(SDCardWebHandler const&) = delete;
   void operator=(SDCardWebHandler const&)   = delete;
 
 private:
+  HttpTransfer* _acquireTransfer();
+  void _finishTransfer(HttpTransfer& transfer);
+
   SDCard _sd;
+  AssetCache _cache;
+  HttpTransfer _transfers[MAX_TRANSFERS];
+  std::unique_ptr<std::uint8_t[]> _streamBuffer;
+  std::size_t _streamChunkSize;
+  StreamStats _streamStats;
 };
@@ -7,12 +7,12 @@
 #include <memory>
 
 class SDCardFile {
-  SDCardFile() : _sd(nullptr), _file() { }
   SDCardFile(std::shared_ptr<SdFs> sd, FsFile&& file) : _sd(sd), _file(std::move(file)) { }
 
   friend class SDCard;
 
 public:
+  SDCardFile() : _sd(nullptr), _file() { }
   ~SDCardFile() { }  // FsFile destructor already closes the file
 
   inline bool isDir() const { return _baseFile().isDir(); }
@@ -69,6 +69,13 @@ public:
 
   inline std::size_t getName(char* name, std::size_t size) { return _baseFile().getName(name, size); }
 
+  // FAT modification date in the upper and time in the lower 16 bits, 0 if it can't be read
+  inline std::uint32_t modifiedDateTime() {
+    std::uint16_t date, time;
+    if (!_baseFile().getModifyDateTime(&date, &time)) return 0;
+    return (static_cast<std::uint32_t>(date) << 16) | time;
+  }
+
   inline bool close() { return _baseFile().close(); }
 
   inline Stream& GetStream() { return _file; }
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "serializers/caixianlin-serialize.hpp"
+
+#include <nonstd/span.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct CaiXianlinMessage {
+  std::uint16_t transmitterId;
+  Channel channel;
+  Command command;
+  std::uint8_t strength;
+};
+
+enum class CaiXianlinParseResult : std::uint8_t {
+  Ok,
+  BadFraming,    // Sync or end symbol missing
+  BadSymbol,     // A byte that isn't one of the four symbols
+  BadChecksum,
+  InvalidValue,  // Checksum matches but a field is out of range
+  BadTiming,     // Pulse widths don't fit the chip grid, or the capture is too short
+};
+
+constexpr std::uint8_t CAIXIANLIN_INVALID_SYMBOL = 0xFF;
+
+// Symbol byte -> 2 bits, CAIXIANLIN_INVALID_SYMBOL for anything else
+constexpr std::array<std::uint8_t, 256> BuildCaiXianlinSymbolTable() {
+  std::array<std::uint8_t, 256> table {};
+  for (std::uint8_t& entry : table) {
+    entry = CAIXIANLIN_INVALID_SYMBOL;
+  }
+  for (std::uint8_t bits = 0; bits < 4; ++bits) {
+    table[static_cast<std::uint8_t>(CAIXIANLIN_SYMBOLS[bits])] = bits;
+  }
+  return table;
+}
+
+constexpr std::array<std::uint8_t, 256> CAIXIANLIN_SYMBOL_BITS = BuildCaiXianlinSymbolTable();
+
+// Decodes count symbols into a value, MSB first. Returns false on an invalid symbol
+constexpr bool DecodeCaiXianlinSymbols(const std::byte* symbols, std::size_t count, std::uint32_t& value) {
+  std::uint8_t invalid = 0;
+  value                = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint8_t bits = CAIXIANLIN_SYMBOL_BITS[static_cast<std::uint8_t>(symbols[i])];
+    invalid |= bits;
+    value = (value << 2) | (bits & 3);
+  }
+  // Only the invalid marker has bits above the low two set
+  return (invalid & 0xFC) == 0;
+}
+
+// Inverse of EncodeCaiXianlinFrame
+constexpr CaiXianlinParseResult ParseCaiXianlinFrame(const std::byte* frame, CaiXianlinMessage& message) {
+  if (frame[0] != CAIXIANLIN_SYNC || frame[CAIXIANLIN_FRAME_SIZE - 1] != CAIXIANLIN_END) {
+    return CaiXianlinParseResult::BadFraming;
+  }
+
+  std::uint32_t transmitterId = 0;
+  std::uint32_t channel       = 0;
+  std::uint32_t command       = 0;
+  std::uint32_t strength      = 0;
+  std::uint32_t checksum      = 0;
+  if (!DecodeCaiXianlinSymbols(frame + 1, 8, transmitterId) || !DecodeCaiXianlinSymbols(frame + 9, 2, channel)
+      || !DecodeCaiXianlinSymbols(frame + 11, 2, command) || !DecodeCaiXianlinSymbols(frame + 13, 4, strength)
+      || !DecodeCaiXianlinSymbols(frame + 17, 4, checksum))
+  {
+    return CaiXianlinParseResult::BadSymbol;
+  }
+
+  std::uint8_t expected = Checksum8(transmitterId) + channel + command + strength;
+  if (checksum != expected) {
+    return CaiXianlinParseResult::BadChecksum;
+  }
+
+  message.transmitterId = static_cast<std::uint16_t>(transmitterId);
+  message.channel       = static_cast<Channel>(channel);
+  message.command       = static_cast<Command>(command);
+  message.strength      = static_cast<std::uint8_t>(strength);
+
+  if (message.channel < Channel::_Min || message.channel > Channel::_Max || message.command < Command::_Min
+      || message.command > Command::_Max || message.strength > 99)
+  {
+    return CaiXianlinParseResult::InvalidValue;
+  }
+
+  return CaiXianlinParseResult::Ok;
+}
+
+constexpr CaiXianlinParseResult ParseMessage(nonstd::span<const std::byte, CAIXIANLIN_FRAME_SIZE> frame,
+                                             CaiXianlinMessage& message) {
+  return ParseCaiXianlinFrame(frame.data(), message);
+}
+
+// Rebuilds the symbol frame from captured pulse widths in microseconds, alternating levels starting with carrier on,
+// then parses it. Every pulse may be off by tolerancePercent of a chip, the last pulse may run into the inter-frame gap.
+// With chipUs 0 the chip length is measured from the sync pulse, so remotes with a slightly different clock decode too.
+CaiXianlinParseResult ParseCaiXianlinPulses(const std::uint16_t* durationsUs,
+                                            std::size_t count,
+                                            CaiXianlinMessage& message,
+                                            std::uint16_t chipUs          = 0,
+                                            std::uint8_t tolerancePercent = 35);
+
+constexpr bool CaiXianlinRoundTrips(std::uint16_t transmitterId, Channel channel, Command command, std::uint8_t strength) {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = MakeCaiXianlinFrame(transmitterId, channel, command, strength);
+
+  CaiXianlinMessage message {};
+  return ParseCaiXianlinFrame(frame.data(), message) == CaiXianlinParseResult::Ok && message.transmitterId == transmitterId
+      && message.channel == channel && message.command == command && message.strength == strength;
+}
+
+static_assert(CaiXianlinRoundTrips(0x1234, Channel::Channel2, Command::Vibrate, 50), "CaiXianlin frame must round trip");
+static_assert(CaiXianlinRoundTrips(0xFFFF, Channel::Channel3, Command::Beep, 99), "CaiXianlin frame must round trip");
+static_assert(CaiXianlinRoundTrips(0x0000, Channel::Channel1, Command::Shock, 0), "CaiXianlin frame must round trip");
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "serializers/caixianlin-deserialize.hpp"
+#include "serializers/caixianlin-serialize.hpp"
+#include "serializers/collar-protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// CollarProtocol policy for CaiXianlin collars
+struct CaiXianlinProtocol {
+  static constexpr const char* NAME          = "CaiXianlin";
+  static constexpr std::size_t FRAME_SIZE    = CAIXIANLIN_FRAME_SIZE;
+  static constexpr std::uint16_t CHIP_US     = 250;
+  static constexpr std::uint8_t MAX_STRENGTH = 99;
+
+  static constexpr std::uint8_t Checksum(const CollarFrameFields& fields) {
+    return Checksum8(fields.transmitterId) + static_cast<std::uint8_t>(fields.channel)
+         + static_cast<std::uint8_t>(fields.command) + fields.strength;
+  }
+
+  static constexpr bool Encode(const CollarFrameFields& fields, std::byte* frame) {
+    return EncodeCaiXianlinFrame(fields.transmitterId, fields.channel, fields.command, fields.strength, frame);
+  }
+
+  static constexpr void PatchStrength(std::byte* frame, const CollarFrameFields& fields) {
+    EncodeCaiXianlinStrength(frame, fields.strength, Checksum(fields));
+  }
+
+  static constexpr bool Decode(const std::byte* frame, CollarFrameFields& fields) {
+    CaiXianlinMessage message {};
+    if (ParseCaiXianlinFrame(frame, message) != CaiXianlinParseResult::Ok) {
+      return false;
+    }
+
+    fields = {message.transmitterId, message.channel, message.command, message.strength};
+    return true;
+  }
+};
+
+static_assert(CollarProtocol<CaiXianlinProtocol>::SelfTest(), "CaiXianlin protocol failed its self test");
@@ -1,30 +1,116 @@
 #pragma once
 
+#include "serializers/collar-protocol.hpp"
+
 #include <nonstd/span.hpp>
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 
-enum class Channel : int {
-  Channel1 = 0,  // Will shift the bit out og the integer, making it 0
-  Channel2 = 1,
-  Channel3 = 2,
+// Frame layout, every symbol byte carries 2 bits MSB first:
+//   [0] sync, [1..8] transmitter ID, [9..10] channel, [11..12] command, [13..16] strength, [17..20] checksum, [21] end
+constexpr std::size_t CAIXIANLIN_FRAME_SIZE  = 22;
+constexpr std::size_t CAIXIANLIN_STRENGTH_AT = 13;
+constexpr std::size_t CAIXIANLIN_CHECKSUM_AT = 17;
+constexpr std::byte CAIXIANLIN_SYNC          = std::byte {0xFC};
+constexpr std::byte CAIXIANLIN_END           = std::byte {0x88};
 
-  _Min = Channel1,
-  _Max = Channel3
-};
+// 2 bits -> symbol byte
+constexpr std::byte CAIXIANLIN_SYMBOLS[4] = {std::byte {0x88}, std::byte {0x8E}, std::byte {0xE8}, std::byte {0xEE}};
 
-enum class Command : std::uint8_t {
-  Shock   = 1,
-  Vibrate = 2,
-  Beep    = 3,
+constexpr std::array<std::array<std::byte, 4>, 256> BuildCaiXianlinByteTable() {
+  std::array<std::array<std::byte, 4>, 256> table {};
+  for (std::size_t value = 0; value < 256; ++value) {
+    for (std::size_t i = 0; i < 4; ++i) {
+      table[value][i] = CAIXIANLIN_SYMBOLS[(value >> (6 - i * 2)) & 3];
+    }
+  }
+  return table;
+}
 
-  _Min = Shock,
-  _Max = Beep
-};
+// 8 bits -> 4 symbol bytes
+constexpr std::array<std::array<std::byte, 4>, 256> CAIXIANLIN_BYTE_SYMBOLS = BuildCaiXianlinByteTable();
+
+constexpr std::uint16_t Checksum8(std::uint16_t value) {
+  return (value >> 8) + (value & 0xFF);
+}
+
+constexpr void EncodeCaiXianlinByte(std::byte* out, std::uint8_t value) {
+  const std::array<std::byte, 4>& symbols = CAIXIANLIN_BYTE_SYMBOLS[value];
+
+  out[0] = symbols[0];
+  out[1] = symbols[1];
+  out[2] = symbols[2];
+  out[3] = symbols[3];
+}
+
+// Strength and the checksum that covers it, the only symbols that differ between the frames of a strength ramp.
+// Rewriting them in a copy of an encoded frame is all a ramp step needs
+constexpr void EncodeCaiXianlinStrength(std::byte* frame, std::uint8_t strength, std::uint8_t checksum) {
+  EncodeCaiXianlinByte(frame + CAIXIANLIN_STRENGTH_AT, strength);
+  EncodeCaiXianlinByte(frame + CAIXIANLIN_CHECKSUM_AT, checksum);
+}
+
+// Writes a complete frame, returns false without touching the frame if a value is out of range
+constexpr bool EncodeCaiXianlinFrame(std::uint16_t transmitterId,
+                                     Channel channel,
+                                     Command command,
+                                     std::uint8_t strength,
+                                     std::byte* frame) {
+  if (channel < Channel::_Min || channel > Channel::_Max || command < Command::_Min || command > Command::_Max || strength > 99)
+  {
+    return false;
+  }
+
+  std::uint8_t channelValue = static_cast<std::uint8_t>(channel);
+  std::uint8_t commandValue = static_cast<std::uint8_t>(command);
+  std::uint8_t checksum     = Checksum8(transmitterId) + channelValue + commandValue + strength;
+
+  frame[0] = CAIXIANLIN_SYNC;
+  EncodeCaiXianlinByte(frame + 1, static_cast<std::uint8_t>(transmitterId >> 8));
+  EncodeCaiXianlinByte(frame + 5, static_cast<std::uint8_t>(transmitterId));
+  frame[9]  = CAIXIANLIN_SYMBOLS[(channelValue >> 2) & 3];
+  frame[10] = CAIXIANLIN_SYMBOLS[channelValue & 3];
+  frame[11] = CAIXIANLIN_SYMBOLS[(commandValue >> 2) & 3];
+  frame[12] = CAIXIANLIN_SYMBOLS[commandValue & 3];
+  EncodeCaiXianlinStrength(frame, strength, checksum);
+  frame[21] = CAIXIANLIN_END;
+
+  return true;
+}
 
 constexpr bool CreateMessage(std::uint16_t transmitterId,
                              Channel channel,
                              Command command,
                              std::uint8_t strength,
-                             nonstd::span<std::byte, 22> message);
+                             nonstd::span<std::byte, CAIXIANLIN_FRAME_SIZE> message) {
+  return EncodeCaiXianlinFrame(transmitterId, channel, command, strength, message.data());
+}
+
+constexpr std::array<std::byte, CAIXIANLIN_FRAME_SIZE>
+  MakeCaiXianlinFrame(std::uint16_t transmitterId, Channel channel, Command command, std::uint8_t strength) {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame {};
+  EncodeCaiXianlinFrame(transmitterId, channel, command, strength, frame.data());
+  return frame;
+}
+
+// Reference frame produced by the previous bit-by-bit encoder for ID 0x1234, channel 2, vibrate, strength 50
+constexpr std::uint8_t CAIXIANLIN_REFERENCE_FRAME[CAIXIANLIN_FRAME_SIZE] = {
+  0xFC, 0x88, 0x8E, 0x88, 0xE8, 0x88, 0xEE, 0x8E, 0x88, 0x88, 0x8E,
+  0x88, 0xE8, 0x88, 0xEE, 0x88, 0xE8, 0x8E, 0xEE, 0xE8, 0xEE, 0x88,
+};
+
+constexpr bool MatchesCaiXianlinReference() {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = MakeCaiXianlinFrame(0x1234, Channel::Channel2, Command::Vibrate, 50);
+  for (std::size_t i = 0; i < CAIXIANLIN_FRAME_SIZE; ++i) {
+    if (static_cast<std::uint8_t>(frame[i]) != CAIXIANLIN_REFERENCE_FRAME[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(MatchesCaiXianlinReference(), "CaiXianlin encoder no longer produces the reference frame");
+static_assert(CAIXIANLIN_BYTE_SYMBOLS[0xB1][0] == std::byte {0xE8} && CAIXIANLIN_BYTE_SYMBOLS[0xB1][3] == std::byte {0x8E},
+              "CaiXianlin byte table must be MSB first");
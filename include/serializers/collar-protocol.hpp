@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+enum class Channel : int {
+  Channel1 = 0,  // Will shift the bit out og the integer, making it 0
+  Channel2 = 1,
+  Channel3 = 2,
+
+  _Min = Channel1,
+  _Max = Channel3
+};
+
+enum class Command : std::uint8_t {
+  Shock   = 1,
+  Vibrate = 2,
+  Beep    = 3,
+
+  _Min = Shock,
+  _Max = Beep
+};
+
+// What a frame carries, independent of the brand
+struct CollarFrameFields {
+  std::uint16_t transmitterId;
+  Channel channel;
+  Command command;
+  std::uint8_t strength;
+};
+
+// A protocol policy describes one collar brand's radio frames. Everything is static and constexpr:
+//   NAME                          Brand name for logs
+//   FRAME_SIZE                    Symbol bytes per frame, every bit is one chip, MSB first, 1 is carrier on
+//   CHIP_US                       On-air duration of one chip
+//   MAX_STRENGTH
+//   Checksum(fields)              Checksum as carried in the frame
+//   Encode(fields, frame)         Writes FRAME_SIZE symbol bytes, false if a field is out of range
+//   PatchStrength(frame, fields)  Rewrites the strength dependent symbols of an encoded frame for fields.strength
+//   Decode(frame, fields)         Inverse of Encode, false on a malformed frame or a checksum mismatch
+// CollarProtocol checks the policy at compile time and is the only way the rest of the firmware talks to it,
+// so every call resolves statically.
+template<typename Policy>
+class CollarProtocol {
+  CollarProtocol() = delete;
+
+  static_assert(Policy::FRAME_SIZE > 0, "Protocol policy needs a frame size");
+  static_assert(Policy::CHIP_US > 0, "Protocol policy needs a chip duration");
+  static_assert(std::is_same_v<decltype(Policy::Encode(std::declval<const CollarFrameFields&>(), std::declval<std::byte*>())),
+                               bool>,
+                "Protocol policy needs bool Encode(const CollarFrameFields&, std::byte*)");
+  static_assert(std::is_same_v<decltype(Policy::Decode(std::declval<const std::byte*>(), std::declval<CollarFrameFields&>())),
+                               bool>,
+                "Protocol policy needs bool Decode(const std::byte*, CollarFrameFields&)");
+
+public:
+  using Frame = std::array<std::byte, Policy::FRAME_SIZE>;
+
+  static constexpr const char* NAME          = Policy::NAME;
+  static constexpr std::size_t FRAME_SIZE    = Policy::FRAME_SIZE;
+  static constexpr std::uint16_t CHIP_US     = Policy::CHIP_US;
+  static constexpr std::uint32_t FRAME_US    = FRAME_SIZE * 8 * CHIP_US;
+  static constexpr std::uint8_t MAX_STRENGTH = Policy::MAX_STRENGTH;
+
+  static constexpr bool Encode(const CollarFrameFields& fields, Frame& frame) { return Policy::Encode(fields, frame.data()); }
+  static constexpr void PatchStrength(Frame& frame, const CollarFrameFields& fields) {
+    Policy::PatchStrength(frame.data(), fields);
+  }
+  static constexpr bool Decode(const Frame& frame, CollarFrameFields& fields) { return Policy::Decode(frame.data(), fields); }
+
+  static constexpr Frame Make(const CollarFrameFields& fields) {
+    Frame frame {};
+    Policy::Encode(fields, frame.data());
+    return frame;
+  }
+
+  static constexpr bool Equals(const CollarFrameFields& a, const CollarFrameFields& b) {
+    return a.transmitterId == b.transmitterId && a.channel == b.channel && a.command == b.command && a.strength == b.strength;
+  }
+
+  // Same checks for every policy: a spread of valid fields must encode and decode unchanged, patching the strength must
+  // match a full encode, and an out of range strength must be rejected
+  static constexpr bool SelfTest() {
+    constexpr std::uint16_t ids[] = {0x0000, 0x0001, 0x1234, 0xA5C3, 0xFFFF};
+
+    for (std::uint16_t id : ids) {
+      for (int channel = static_cast<int>(Channel::_Min); channel <= static_cast<int>(Channel::_Max); ++channel) {
+        for (int command = static_cast<int>(Command::_Min); command <= static_cast<int>(Command::_Max); ++command) {
+          for (std::uint8_t strength : {std::uint8_t {0}, static_cast<std::uint8_t>(MAX_STRENGTH / 2), MAX_STRENGTH}) {
+            CollarFrameFields fields {id, static_cast<Channel>(channel), static_cast<Command>(command), strength};
+
+            Frame frame {};
+            CollarFrameFields decoded {};
+            if (!Encode(fields, frame) || !Decode(frame, decoded) || !Equals(fields, decoded)) {
+              return false;
+            }
+
+            CollarFrameFields other = fields;
+            other.strength          = MAX_STRENGTH - strength;
+            Frame patched           = Make(other);
+            PatchStrength(patched, fields);
+            for (std::size_t i = 0; i < FRAME_SIZE; ++i) {
+              if (patched[i] != frame[i]) {
+                return false;
+              }
+            }
+          }
+        }
+      }
+    }
+
+    Frame frame {};
+    return !Encode({0x1234, Channel::_Min, Command::_Min, static_cast<std::uint8_t>(MAX_STRENGTH + 1)}, frame);
+  }
+};
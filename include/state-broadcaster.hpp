@@ -0,0 +1,84 @@
+#pragma once
+
+#include "collar-command.hpp"
+#include "ws-protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Publishes device state to subscribed WebSocket clients.
+// Changes are coalesced for COALESCE_MS and serialized once per wire format, every subscriber of that format
+// is then sent the same frame. Nothing is sent while the state doesn't change.
+class StateBroadcaster {
+public:
+  static constexpr std::uint32_t COALESCE_MS      = 50;
+  static constexpr std::uint32_t HEAP_GRANULARITY = 1024;  // Free heap is reported in steps so allocator noise isn't published
+  static constexpr std::size_t MAX_TEXT_SIZE      = 192;
+
+  enum Field : std::uint8_t {
+    FIELD_COMMAND    = 1 << 0,
+    FIELD_AP_CLIENTS = 1 << 1,
+    FIELD_TIME_VALID = 1 << 2,
+    FIELD_FREE_HEAP  = 1 << 3,
+    FIELD_ALL        = FIELD_COMMAND | FIELD_AP_CLIENTS | FIELD_TIME_VALID | FIELD_FREE_HEAP,
+  };
+
+  struct State {
+    CollarCommand command;  // Last command executed
+    std::uint8_t apClients;
+    bool timeValid;
+    std::uint32_t freeHeap;
+  };
+
+  // Frames ready to be sent, the buffers stay valid until the next call to update()
+  struct Broadcast {
+    std::uint32_t binaryClients;  // Bit per client ID
+    std::uint32_t textClients;
+    const std::uint8_t* binary;
+    std::size_t binaryLength;
+    const char* text;
+    std::size_t textLength;
+  };
+
+  struct Stats {
+    std::uint32_t changes;     // Field changes published
+    std::uint32_t broadcasts;  // Frames serialized, at most one per format per broadcast
+    std::uint32_t deliveries;  // Frames handed to clients
+  };
+
+  StateBroadcaster();
+
+  void setCommand(const CollarCommand& command, std::uint32_t now);
+  void setApClientCount(std::uint8_t count, std::uint32_t now);
+  void setTimeValid(bool valid, std::uint32_t now);
+  void setFreeHeap(std::uint32_t freeHeap, std::uint32_t now);
+
+  // New subscribers get a full snapshot with the next broadcast
+  void subscribe(std::uint8_t clientId, bool binary, std::uint32_t now);
+  void unsubscribe(std::uint8_t clientId);
+
+  // Returns true if the client subscribed, along with the format it asked for
+  bool isSubscribed(std::uint8_t clientId, bool& binary) const;
+
+  // Returns true once the coalescing window of pending changes has passed, with the frames to send
+  bool update(std::uint32_t now, Broadcast& broadcast);
+
+  const State& state() const { return _state; }
+  const Stats& stats() const { return _stats; }
+
+private:
+  void _markDirty(std::uint8_t fields, std::uint32_t now);
+  void _encodeBinary();
+  void _encodeText();
+
+  State _state;
+  std::uint16_t _revision;
+  std::uint8_t _dirty;
+  std::uint32_t _dirtySince;
+  std::uint32_t _binaryClients;
+  std::uint32_t _textClients;
+  std::uint8_t _binaryFrame[WsProtocol::STATE_SIZE];
+  char _textFrame[MAX_TEXT_SIZE];
+  std::size_t _textLength;
+  Stats _stats;
+};
@@ -1,10 +1,33 @@
 #pragma once
 
+#include "asset-cache.hpp"
+#include "command-queue.hpp"
+#include "rf-scheduler.hpp"
+#include "sdcard-webhandler.hpp"
+
 #include <cstdint>
 
 struct WebServices {
+  // Time from a command frame arriving to it being handed to the RF scheduler, including time spent queued
+  struct CommandStats {
+    std::uint32_t count;
+    std::uint32_t rejected;
+    std::uint32_t totalMicros;
+    std::uint32_t maxMicros;
+  };
+
   static void Start();
   static void Stop();
   static bool IsRunning();
   static void Update();
+
+  // Published to state subscribers, the rest of the device state is sampled by the web services themselves
+  static void SetTimeValid(bool valid);
+
+  static const CommandStats& GetBinaryCommandStats();
+  static const CommandStats& GetJsonCommandStats();
+  static const CommandQueue::Stats& GetCommandQueueStats();
+  static const RfScheduler::Stats& GetRfSchedulerStats();
+  static const AssetCache::Stats& GetAssetCacheStats();
+  static const SDCardWebHandler::StreamStats& GetStreamStats();
 };
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <ESP8266WebServer.h>
+
+// Lists, adds and removes the networks the station may join:
+//   GET    /api/wifi/profiles              SSIDs and how well joining them worked, keys are never sent back
+//   POST   /api/wifi/profiles ssid=&psk=   adds a network or replaces its key
+//   DELETE /api/wifi/profiles?ssid=        removes a network
+class WiFiProfilesWebHandler : public RequestHandler {
+  using WebServerType = esp8266webserver::ESP8266WebServerTemplate<WiFiServer>;
+
+public:
+  WiFiProfilesWebHandler() = default;
+
+  bool canHandle(HTTPMethod method, const String& uri) override;
+  bool handle(WebServerType& server, HTTPMethod requestMethod, const String& requestUri) override;
+
+  WiFiProfilesWebHandler(WiFiProfilesWebHandler const&) = delete;
+  void operator=(WiFiProfilesWebHandler const&)         = delete;
+
+private:
+  static void _list(WebServerType& server);
+};
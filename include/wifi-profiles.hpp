@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Networks the station may join, kept in an encrypted file and held in RAM as a fixed array.
+// Scan results are matched by a hash of their SSID, so one pass over them compares a single integer per profile.
+// Candidates are ranked by signal strength plus how often joining that network has worked before, a network that just
+// failed drops behind the others until it works again.
+class WiFiProfiles {
+public:
+  static constexpr std::size_t MAX_PROFILES        = 8;
+  static constexpr std::size_t MAX_SSID_LENGTH     = 32;
+  static constexpr std::size_t MAX_PSK_LENGTH      = 64;
+  static constexpr std::int32_t SUCCESS_WEIGHT_DB  = 20;  // Lead of a network that always worked over one that never did
+  static constexpr std::int32_t FAILURE_PENALTY_DB = 15;  // Per consecutive failure, so other networks get a turn
+
+  struct Profile {
+    std::uint32_t ssidHash;
+    std::uint8_t attempts;
+    std::uint8_t successes;
+    std::uint8_t failures;  // Consecutive, reset by the next success
+    char ssid[MAX_SSID_LENGTH + 1];
+    char psk[MAX_PSK_LENGTH + 1];
+  };
+
+  // Best scan result that has a profile, scanIndex is -1 if none did
+  struct Candidate {
+    std::int8_t scanIndex;
+    std::size_t profile;
+    std::int32_t score;
+  };
+
+  WiFiProfiles();
+
+  // Whether the profiles file is on the SD card, a file that exists but can't be loaded must not be overwritten
+  static bool Exists();
+
+  bool load();
+  bool save();
+
+  // Counters changed since the last save
+  bool dirty() const { return _dirty; }
+
+  bool add(const char* ssid, const char* psk);
+  bool remove(const char* ssid);
+
+  std::size_t count() const { return _count; }
+  const Profile& at(std::size_t index) const { return _profiles[index]; }
+
+  // Index of the profile, MAX_PROFILES if there is none
+  std::size_t find(const char* ssid) const;
+
+  // Ranks the results of the last WiFi scan
+  Candidate select(std::int8_t networksFound) const;
+
+  // Returns true if the ranking changed enough to save right away: the network failed, or worked again after failing.
+  // Other results only add to the counters in RAM, so a boot that joins the usual network doesn't write the SD card
+  bool recordResult(std::size_t index, bool connected);
+
+  static std::uint32_t HashSsid(const std::uint8_t* ssid, std::size_t length);
+
+private:
+  std::size_t _find(std::uint32_t hash, const std::uint8_t* ssid, std::size_t length) const;
+
+  Profile _profiles[MAX_PROFILES];
+  std::size_t _count;
+  bool _dirty;
+};
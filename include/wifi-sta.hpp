@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+class WiFiProfiles;
+
+// Station mode. The access point and channel of the last successful connection are kept in an encrypted file, so a
+// boot or reconnect goes straight to that access point without scanning. The address always comes from DHCP.
+// Only when that fails is the cached access point dropped in favour of a scan, which joins the best network from
+// WiFiProfiles.
+class WiFi_STA {
+  WiFi_STA() = delete;
+
+public:
+  static bool Start();
+  static void Stop();
+  static void Update();
+
+  static bool IsConnected();
+
+  // Adds a network or replaces its key, saved right away
+  static bool AddProfile(const char* ssid, const char* psk);
+  static bool RemoveProfile(const char* ssid);
+  static const WiFiProfiles& GetProfiles();
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "collar-command.hpp"
+
+#include <nonstd/span.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary WebSocket frames, every frame starts with the same 4 byte header:
+//   [0] version, [1] opcode, [2..3] sequence number
+// All multi-byte fields are little-endian.
+//
+// Command     (client -> device, 11 bytes): [4..5] transmitter ID, [6] channel, [7] command, [8] strength, [9..10] duration ms
+// Stop        (client -> device, 7 bytes):  [4..5] transmitter ID, [6] channel
+// Subscribe   (client -> device, 4 bytes):  header only, state updates are sent in the format of this frame
+// Unsubscribe (client -> device, 4 bytes):  header only
+// Pattern     (client -> device, 9 + 4n):   [4..5] transmitter ID, [6] channel, [7] loops (0 until stopped, 60 s at most),
+//                                           [8] keyframe count n, then per keyframe: [0] shape << 4 | command,
+//                                           [1] strength, [2..3] duration ms
+// Ack         (device -> client, 5 bytes):  [4] status
+// State       (device -> client, 19 bytes): sequence is the state revision, [4] changed field mask, [5] action,
+//                                           [6..7] transmitter ID, [8] channel, [9] command, [10] strength,
+//                                           [11..12] duration ms, [13] AP client count, [14] time valid, [15..18] free heap
+// Latency     (device -> client, 12 bytes): sequence is 0, [4..5] last RTT ms, [6..7] p50 ms, [8..9] p99 ms, [10..11] samples
+class WsProtocol {
+  WsProtocol() = delete;
+
+public:
+  static constexpr std::uint8_t VERSION     = 1;
+  static constexpr std::size_t HEADER_SIZE  = 4;
+  static constexpr std::size_t COMMAND_SIZE = 11;
+  static constexpr std::size_t STOP_SIZE    = 7;
+  static constexpr std::size_t ACK_SIZE     = 5;
+  static constexpr std::size_t STATE_SIZE   = 19;
+  static constexpr std::size_t LATENCY_SIZE = 12;
+
+  static constexpr std::size_t PATTERN_HEADER_SIZE = 9;
+  static constexpr std::size_t KEYFRAME_SIZE       = 4;
+  static constexpr std::size_t MAX_KEYFRAMES       = 16;
+  static constexpr std::size_t MAX_PATTERN_SIZE    = PATTERN_HEADER_SIZE + MAX_KEYFRAMES * KEYFRAME_SIZE;
+
+  enum class Opcode : std::uint8_t {
+    Command     = 0x01,
+    Stop        = 0x02,
+    Subscribe   = 0x03,
+    Unsubscribe = 0x04,
+    Pattern     = 0x05,
+    Ack         = 0x81,
+    State       = 0x82,
+    Latency     = 0x83,
+  };
+
+  enum class Status : std::uint8_t {
+    Ok                 = 0,
+    Malformed          = 1,
+    UnsupportedVersion = 2,
+    UnknownOpcode      = 3,
+    InvalidCommand     = 4,
+    RateLimited        = 5,
+    QueueFull          = 6,
+    Busy               = 7,  // A pattern for another collar is playing
+  };
+
+  struct Message {
+    Opcode opcode;
+    std::uint16_t sequence;
+    CollarCommand command;  // For a pattern the collar and its first keyframe
+    std::uint8_t patternLoops;
+    std::uint8_t keyframeCount;
+    const std::uint8_t* keyframes;  // Validated keyframes of a pattern, points into the decoded frame
+  };
+
+  static constexpr std::uint16_t ReadU16(const std::uint8_t* data) {
+    return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+  }
+
+  static constexpr void WriteU16(std::uint8_t* data, std::uint16_t value) {
+    data[0] = static_cast<std::uint8_t>(value);
+    data[1] = static_cast<std::uint8_t>(value >> 8);
+  }
+
+  static constexpr void WriteU32(std::uint8_t* data, std::uint32_t value) {
+    WriteU16(data, static_cast<std::uint16_t>(value));
+    WriteU16(data + 2, static_cast<std::uint16_t>(value >> 16));
+  }
+
+  static constexpr CollarKeyframe ReadKeyframe(const std::uint8_t* data) {
+    return {static_cast<KeyframeShape>(data[0] >> 4), static_cast<Command>(data[0] & 0x0F), data[1], ReadU16(data + 2)};
+  }
+
+  // Decodes a frame in place without allocating. The sequence number is filled in whenever the header is readable,
+  // so even rejected frames can be acknowledged
+  static constexpr Status Decode(const std::uint8_t* data, std::size_t length, Message& message) {
+    if (length < HEADER_SIZE) {
+      return Status::Malformed;
+    }
+
+    message.opcode        = static_cast<Opcode>(data[1]);
+    message.sequence      = ReadU16(data + 2);
+    message.patternLoops  = 0;
+    message.keyframeCount = 0;
+    message.keyframes     = nullptr;
+
+    if (data[0] != VERSION) {
+      return Status::UnsupportedVersion;
+    }
+
+    CollarCommand& command = message.command;
+    switch (message.opcode) {
+      case Opcode::Command:
+        if (length != COMMAND_SIZE) {
+          return Status::Malformed;
+        }
+        command.action        = CollarAction::Transmit;
+        command.transmitterId = ReadU16(data + 4);
+        command.channel       = static_cast<Channel>(data[6]);
+        command.command       = static_cast<Command>(data[7]);
+        command.strength      = data[8];
+        command.durationMs    = ReadU16(data + 9);
+        if (command.channel < Channel::_Min || command.channel > Channel::_Max || command.command < Command::_Min
+            || command.command > Command::_Max || command.strength > 99)
+        {
+          return Status::InvalidCommand;
+        }
+        return Status::Ok;
+      case Opcode::Stop:
+        if (length != STOP_SIZE) {
+          return Status::Malformed;
+        }
+        command               = {};
+        command.action        = CollarAction::Stop;
+        command.transmitterId = ReadU16(data + 4);
+        command.channel       = static_cast<Channel>(data[6]);
+        if (command.channel < Channel::_Min || command.channel > Channel::_Max) {
+          return Status::InvalidCommand;
+        }
+        return Status::Ok;
+      case Opcode::Pattern:
+        if (length < PATTERN_HEADER_SIZE || length != PATTERN_HEADER_SIZE + data[8] * KEYFRAME_SIZE) {
+          return Status::Malformed;
+        }
+        command               = {};
+        command.action        = CollarAction::Pattern;
+        command.transmitterId = ReadU16(data + 4);
+        command.channel       = static_cast<Channel>(data[6]);
+        message.patternLoops  = data[7];
+        message.keyframeCount = data[8];
+        message.keyframes     = data + PATTERN_HEADER_SIZE;
+        if (command.channel < Channel::_Min || command.channel > Channel::_Max || message.keyframeCount == 0
+            || message.keyframeCount > MAX_KEYFRAMES)
+        {
+          return Status::InvalidCommand;
+        }
+        for (std::size_t i = 0; i < message.keyframeCount; ++i) {
+          CollarKeyframe keyframe = ReadKeyframe(message.keyframes + i * KEYFRAME_SIZE);
+          bool pause              = keyframe.shape == KeyframeShape::Pause;
+          if (keyframe.shape > KeyframeShape::_Max || keyframe.durationMs == 0 || (i == 0 && pause)
+              || (!pause && (keyframe.command < Command::_Min || keyframe.command > Command::_Max || keyframe.strength > 99)))
+          {
+            return Status::InvalidCommand;
+          }
+          if (i == 0) {
+            command.command  = keyframe.command;
+            command.strength = keyframe.strength;
+          }
+        }
+        return Status::Ok;
+      case Opcode::Subscribe:
+      case Opcode::Unsubscribe:
+        if (length != HEADER_SIZE) {
+          return Status::Malformed;
+        }
+        command = {};
+        return Status::Ok;
+      default:
+        return Status::UnknownOpcode;
+    }
+  }
+
+  static constexpr void EncodeAck(std::uint16_t sequence, Status status, nonstd::span<std::uint8_t, ACK_SIZE> frame) {
+    frame[0] = VERSION;
+    frame[1] = static_cast<std::uint8_t>(Opcode::Ack);
+    WriteU16(frame.data() + 2, sequence);
+    frame[4] = static_cast<std::uint8_t>(status);
+  }
+};
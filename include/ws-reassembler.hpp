@@ -0,0 +1,89 @@
+#pragma once
+
+#include "json-command-parser.hpp"
+#include "ws-protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Largest fragmented message that is reassembled, sized for configuration uploads rather than single commands
+#ifndef WS_REASSEMBLY_MAX_MESSAGE_SIZE
+#define WS_REASSEMBLY_MAX_MESSAGE_SIZE 2048
+#endif
+
+// RAM set aside for reassembly buffers, every buffer holds one message of WS_REASSEMBLY_MAX_MESSAGE_SIZE
+#ifndef WS_REASSEMBLY_BUDGET
+#define WS_REASSEMBLY_BUDGET (4 * 1024)
+#endif
+
+// Collects fragmented WebSocket messages into a small fixed pool of buffers.
+// Unfragmented messages never pass through here and are handled straight from the socket buffer.
+// Anything longer than MAX_MESSAGE_SIZE is dropped while it is still arriving.
+class WsReassembler {
+public:
+  static constexpr std::size_t MAX_MESSAGE_SIZE = WS_REASSEMBLY_MAX_MESSAGE_SIZE;
+  static constexpr std::size_t POOL_SIZE        = WS_REASSEMBLY_BUDGET / MAX_MESSAGE_SIZE;
+  static constexpr std::uint32_t TIMEOUT_MS     = 3000;
+
+  static_assert(MAX_MESSAGE_SIZE >= JsonCommandParser::MAX_MESSAGE_SIZE && MAX_MESSAGE_SIZE >= WsProtocol::MAX_PATTERN_SIZE,
+                "Every command a parser accepts must fit a reassembly buffer");
+  static_assert(POOL_SIZE > 0, "WS_REASSEMBLY_BUDGET must hold at least one message");
+
+  enum class Result : std::uint8_t {
+    Pending,   // Fragment stored, waiting for more
+    Complete,  // Message is ready, call release() once it has been handled
+    Dropped,   // Message was discarded, remaining fragments are ignored until the final one
+    Skipped,   // Fragment of a message that was dropped earlier
+  };
+
+  struct Message {
+    bool binary;
+    const std::uint8_t* data;
+    std::size_t length;
+  };
+
+  struct Stats {
+    std::uint32_t completed;
+    std::uint32_t droppedOversize;
+    std::uint32_t droppedNoBuffer;
+    std::uint32_t droppedTimeout;
+  };
+
+  WsReassembler();
+
+  Result begin(std::uint8_t clientId, bool binary, const std::uint8_t* data, std::size_t length, std::uint32_t now);
+  Result append(std::uint8_t clientId,
+                const std::uint8_t* data,
+                std::size_t length,
+                bool final,
+                std::uint32_t now,
+                Message& message);
+
+  // Frees the buffer of a completed message
+  void release(std::uint8_t clientId);
+
+  // Forgets any partial message of a client, call when it disconnects
+  void drop(std::uint8_t clientId);
+
+  // Drops partial messages that haven't seen a fragment for TIMEOUT_MS
+  void expire(std::uint32_t now);
+
+  const Stats& stats() const { return _stats; }
+
+private:
+  struct Slot {
+    bool inUse;
+    bool binary;
+    std::uint8_t clientId;
+    std::size_t length;
+    std::uint32_t lastFragment;
+    std::uint8_t data[MAX_MESSAGE_SIZE];
+  };
+
+  Slot* _findSlot(std::uint8_t clientId);
+  void _discard(std::uint8_t clientId);
+
+  Slot _slots[POOL_SIZE];
+  std::uint32_t _discarding;  // Bit per client whose current message is being skipped
+  Stats _stats;
+};
@@ -0,0 +1,280 @@
+#include "asset-cache.hpp"
+
+#include "logger.hpp"
+#include "mime-types.hpp"
+
+#include <Arduino.h>
+
+#include <cstring>
+
+AssetCache::AssetCache(std::size_t budget) : _entries(), _budget(budget), _tick(0), _stats() { }
+
+const AssetCache::Entry* AssetCache::find(const char* path, SDCard& sd) {
+  if (!enabled()) {
+    return nullptr;
+  }
+
+  // A pinned entry whose file changed has been reloaded by _revalidate() and is found again
+  std::uint32_t pathHash = _hashPath(path);
+  Entry* entry           = _findEntry(path, pathHash);
+  if (entry != nullptr && !_revalidate(*entry, sd)) {
+    entry = _findEntry(path, pathHash);
+  }
+  if (entry == nullptr && _reloadPinned(path, pathHash, sd)) {
+    entry = _findEntry(path, pathHash);
+  }
+  if (entry == nullptr) {
+    _stats.misses++;
+    return nullptr;
+  }
+
+  _stats.hits++;
+  entry->lastUsed = ++_tick;
+
+  return entry;
+}
+
+const AssetCache::Entry* AssetCache::insert(const char* path, const char* contentType, SDCardFile& file, bool pinned) {
+  std::size_t pathLen = std::strlen(path);
+  std::size_t size    = file.size();
+  if (!enabled() || pathLen >= MAX_PATH_LEN || size == 0 || size > _budget) {
+    return nullptr;
+  }
+
+  std::uint32_t pathHash = _hashPath(path);
+  if (Entry* existing = _findEntry(path, pathHash); existing != nullptr) {
+    existing->pinned |= pinned;
+    return existing;
+  }
+
+  // A pinned file that changed while it was being read stays pinned, it is loaded once the old data has been freed
+  if (Entry* pending = _findReload(path, pathHash); pending != nullptr) {
+    if (pending->data) {
+      return nullptr;
+    }
+    pending->reload = false;
+    pinned          = true;
+  }
+
+  Entry* entry = _reserve(size);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+
+  entry->data.reset(new (std::nothrow) std::uint8_t[size]);
+  if (!entry->data) {
+    return nullptr;
+  }
+
+  if (!file.seekBeg(0) || file.read(entry->data.get(), size) != size) {
+    entry->data.reset();
+    return nullptr;
+  }
+
+  entry->pathHash = pathHash;
+  std::memcpy(entry->path, path, pathLen + 1);
+  entry->contentType = contentType;
+  entry->size        = size;
+  entry->modified    = file.modifiedDateTime();
+  entry->checkedAt   = millis();
+  entry->lastUsed    = ++_tick;
+  entry->readers     = 0;
+  entry->pinned      = pinned;
+  entry->stale       = false;
+  entry->reload      = false;
+
+  _stats.insertions++;
+  _stats.bytesUsed += size;
+  _stats.entryCount++;
+
+  return entry;
+}
+
+void AssetCache::release(const Entry& entry) {
+  Entry& owned = _entries[&entry - _entries];
+  if (--owned.readers == 0 && owned.stale) {
+    _evict(owned);
+  }
+}
+
+std::size_t AssetCache::loadManifest(SDCard& sd) {
+  if (!enabled()) {
+    return 0;
+  }
+
+  auto manifest = sd.open(MANIFEST_PATH, O_READ);
+  if (!manifest) {
+    return 0;
+  }
+
+  std::size_t loaded = 0;
+
+  char line[MAX_PATH_LEN];
+  std::size_t lineLen = 0;
+  bool overflow       = false;
+  while (true) {
+    char c;
+    bool eof = manifest.read(&c, 1) != 1;
+
+    if (eof || c == '\n' || c == '\r') {
+      if (lineLen > 0 && !overflow) {
+        line[lineLen] = '\0';
+
+        const char* dot = std::strrchr(line, '.');
+        auto file       = sd.open(line, O_READ);
+        if (file && insert(line, MimeTypes::Get(dot), file, true) != nullptr) {
+          loaded++;
+        } else {
+          Logger::printlnf("[AssetCache] Unable to pin \"%s\"", line);
+        }
+      }
+      lineLen  = 0;
+      overflow = false;
+
+      if (eof) {
+        break;
+      }
+      continue;
+    }
+
+    if (lineLen < sizeof(line) - 1) {
+      line[lineLen++] = c;
+    } else {
+      overflow = true;
+    }
+  }
+
+  Logger::printlnf("[AssetCache] Pinned %u assets (%u bytes) from manifest", loaded, _stats.bytesUsed);
+
+  return loaded;
+}
+
+std::uint32_t AssetCache::_hashPath(const char* path) {
+  std::uint32_t hash = 2'166'136'261U;
+  while (*path != '\0') {
+    hash ^= static_cast<std::uint8_t>(*path++);
+    hash *= 16'777'619U;
+  }
+  return hash;
+}
+
+AssetCache::Entry* AssetCache::_findEntry(const char* path, std::uint32_t pathHash) {
+  for (Entry& entry : _entries) {
+    if (entry.data && !entry.stale && entry.pathHash == pathHash && std::strcmp(entry.path, path) == 0) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+AssetCache::Entry* AssetCache::_findReload(const char* path, std::uint32_t pathHash) {
+  for (Entry& entry : _entries) {
+    if (entry.reload && entry.pathHash == pathHash && std::strcmp(entry.path, path) == 0) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+bool AssetCache::_revalidate(Entry& entry, SDCard& sd) {
+  std::uint32_t now = millis();
+  if (now - entry.checkedAt < REVALIDATE_INTERVAL_MS) {
+    return true;
+  }
+  entry.checkedAt = now;
+
+  auto file = sd.open(entry.path, O_READ);
+  if (file && file.size() == entry.size && file.modifiedDateTime() == entry.modified) {
+    return true;
+  }
+
+  Logger::printlnf("[AssetCache] \"%s\" changed on the SD card, dropping it", entry.path);
+  _stats.invalidations++;
+
+  char path[MAX_PATH_LEN];
+  std::memcpy(path, entry.path, sizeof(path));
+  const char* contentType = entry.contentType;
+  bool pinned             = entry.pinned;
+
+  // Responses still streaming the old data keep it alive until they finish. A pinned file is only read again after that,
+  // so the old and the new data never take up the budget together
+  if (entry.readers > 0) {
+    entry.stale  = true;
+    entry.reload = pinned;
+    return false;
+  }
+  _evict(entry);
+
+  if (pinned && file && insert(path, contentType, file, true) == nullptr) {
+    Logger::printlnf("[AssetCache] Unable to reload pinned \"%s\"", path);
+  }
+
+  return false;
+}
+
+bool AssetCache::_reloadPinned(const char* path, std::uint32_t pathHash, SDCard& sd) {
+  Entry* pending = _findReload(path, pathHash);
+  if (pending == nullptr || pending->data) {
+    return false;
+  }
+
+  auto file = sd.open(path, O_READ);
+  if (!file) {
+    pending->reload = false;
+    return false;
+  }
+
+  if (insert(path, pending->contentType, file, true) == nullptr) {
+    Logger::printlnf("[AssetCache] Unable to reload pinned \"%s\"", path);
+    return false;
+  }
+
+  return true;
+}
+
+AssetCache::Entry* AssetCache::_reserve(std::size_t size) {
+  // Pinned entries and entries still being read stay, nothing is evicted for a file that can't fit beside them
+  std::size_t held = 0;
+  for (const Entry& entry : _entries) {
+    if (entry.data && (entry.pinned || entry.readers > 0)) {
+      held += entry.size;
+    }
+  }
+  if (held + size > _budget) {
+    return nullptr;
+  }
+
+  while (true) {
+    Entry* freeEntry = nullptr;
+    Entry* lruEntry  = nullptr;
+    for (Entry& entry : _entries) {
+      if (!entry.data) {
+        // A slot waiting for a pinned reload is only given up when no other slot is free
+        if (freeEntry == nullptr || (freeEntry->reload && !entry.reload)) freeEntry = &entry;
+      } else if (!entry.pinned && entry.readers == 0 && (lruEntry == nullptr || entry.lastUsed < lruEntry->lastUsed)) {
+        lruEntry = &entry;
+      }
+    }
+
+    if (freeEntry != nullptr && _stats.bytesUsed + size <= _budget) {
+      return freeEntry;
+    }
+
+    // Out of slots or budget, the only option left is evicting the least recently used unpinned entry
+    if (lruEntry == nullptr) {
+      return nullptr;
+    }
+    _evict(*lruEntry);
+  }
+}
+
+void AssetCache::_evict(Entry& entry) {
+  _stats.evictions++;
+  _stats.bytesUsed -= entry.size;
+  _stats.entryCount--;
+
+  entry.data.reset();
+  entry.size   = 0;
+  entry.pinned = false;
+  entry.stale  = false;
+}
@@ -0,0 +1,88 @@
+#include "captive-portal.hpp"
+
+#include <ESP8266WiFi.h>
+
+const char PATH_GENERATE_204[] PROGMEM   = "/generate_204";
+const char PATH_GEN_204[] PROGMEM        = "/gen_204";
+const char PATH_HOTSPOT_DETECT[] PROGMEM = "/hotspot-detect.html";
+const char PATH_APPLE_SUCCESS[] PROGMEM  = "/library/test/success.html";
+const char PATH_NCSI[] PROGMEM           = "/ncsi.txt";
+const char PATH_CONNECT_TEST[] PROGMEM   = "/connecttest.txt";
+const char PATH_MS_REDIRECT[] PROGMEM    = "/redirect";
+const char PATH_FIREFOX_CANON[] PROGMEM  = "/canonical.html";
+const char PATH_FIREFOX_TXT[] PROGMEM    = "/success.txt";
+const char PATH_KINDLE_WIFI[] PROGMEM    = "/kindle-wifi/wifistub.html";
+
+const char TYPE_HTML[] PROGMEM = "text/html";
+const char TYPE_TEXT[] PROGMEM = "text/plain";
+
+const char BODY_APPLE_SUCCESS[] PROGMEM = "<HTML><HEAD><TITLE>Success</TITLE></HEAD><BODY>Success</BODY></HTML>";
+const char BODY_NCSI[] PROGMEM          = "Microsoft NCSI";
+const char BODY_CONNECT_TEST[] PROGMEM  = "Microsoft Connect Test";
+const char BODY_FIREFOX_CANON[] PROGMEM = "<meta http-equiv=\"refresh\" content=\"0;url=https://support.mozilla.org/kb/captive-portal\"/>";
+const char BODY_FIREFOX_TXT[] PROGMEM   = "success\n";
+const char BODY_KINDLE_WIFI[] PROGMEM   = "81ce4465-7167-4dcb-835b-dcc9e44c112a";
+
+using ProbeResponse = CaptivePortalHandler::ProbeResponse;
+
+const CaptivePortalHandler::ProbeRoute PROBE_ROUTES[] = {
+  {  PATH_GENERATE_204, ProbeResponse::NoContent,   nullptr,            nullptr},
+  {       PATH_GEN_204, ProbeResponse::NoContent,   nullptr,            nullptr},
+  {PATH_HOTSPOT_DETECT,   ProbeResponse::Success, TYPE_HTML, BODY_APPLE_SUCCESS},
+  { PATH_APPLE_SUCCESS,   ProbeResponse::Success, TYPE_HTML, BODY_APPLE_SUCCESS},
+  {          PATH_NCSI,   ProbeResponse::Success, TYPE_TEXT,          BODY_NCSI},
+  {  PATH_CONNECT_TEST,   ProbeResponse::Success, TYPE_TEXT,  BODY_CONNECT_TEST},
+  {   PATH_MS_REDIRECT,  ProbeResponse::Redirect,   nullptr,            nullptr},
+  { PATH_FIREFOX_CANON,   ProbeResponse::Success, TYPE_HTML, BODY_FIREFOX_CANON},
+  {   PATH_FIREFOX_TXT,   ProbeResponse::Success, TYPE_TEXT,   BODY_FIREFOX_TXT},
+  {   PATH_KINDLE_WIFI,   ProbeResponse::Success, TYPE_HTML,   BODY_KINDLE_WIFI},
+};
+
+CaptivePortalHandler::CaptivePortalHandler() : _redirectEnabled(true), _probeCount(0) { }
+
+bool CaptivePortalHandler::canHandle(HTTPMethod method, const String& uri) {
+  return method == HTTP_GET && _findRoute(uri) != nullptr;
+}
+
+bool CaptivePortalHandler::handle(WebServerType& server, HTTPMethod requestMethod, const String& requestUri) {
+  (void)requestMethod;
+
+  const ProbeRoute* route = _findRoute(requestUri);
+  if (route == nullptr) {
+    return false;
+  }
+
+  _probeCount++;
+
+  // Probes must never be cached, otherwise the OS keeps its stale connectivity verdict
+  server.sendHeader(F("Cache-Control"), F("no-cache, no-store, must-revalidate"));
+
+  if (_redirectEnabled || route->response == ProbeResponse::Redirect) {
+    IPAddress apIP = WiFi.softAPIP();
+
+    char location[32];
+    snprintf(location, sizeof(location), "http://%u.%u.%u.%u/", apIP[0], apIP[1], apIP[2], apIP[3]);
+    server.sendHeader(F("Location"), location);
+    server.send(302, "text/plain", "");
+    return true;
+  }
+
+  if (route->response == ProbeResponse::NoContent) {
+    server.send(204, "text/plain", "");
+    return true;
+  }
+
+  server.send_P(200, route->contentType, route->body);
+
+  return true;
+}
+
+const CaptivePortalHandler::ProbeRoute* CaptivePortalHandler::_findRoute(const String& uri) {
+  for (const ProbeRoute& route : PROBE_ROUTES) {
+    if (strcmp_P(uri.c_str(), route.path) == 0) {
+      return &route;
+    }
+  }
+
+  return nullptr;
+}
@@ -0,0 +1,143 @@
+#include "command-queue.hpp"
+
+CommandQueue::CommandQueue() : _stops(), _commands(), _buckets(), _stats() {
+  for (Bucket& bucket : _buckets) {
+    bucket.tokens = BUCKET_SIZE;
+  }
+}
+
+CommandQueue::Admission CommandQueue::push(const Entry& entry, std::uint32_t now) {
+  if (entry.clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return Admission::QueueFull;
+  }
+
+  const CollarCommand& command = entry.message.command;
+
+  Bucket& bucket = _buckets[entry.clientId];
+
+  if (command.action == CollarAction::Stop) {
+    if (bucket.stops >= MAX_STOPS_PER_CLIENT || _stops.full()) {
+      _stats.droppedQueueFull++;
+      return Admission::QueueFull;
+    }
+
+    // Anything still queued for this collar would restart it right after the stop
+    _stats.droppedPreempted += _removeCommands([&command](const Entry& queued) {
+      return queued.message.command.transmitterId == command.transmitterId
+          && queued.message.command.channel == command.channel;
+    });
+
+    bucket.stops++;
+    _stops.push(entry);
+    _stats.queued++;
+    _updateDepth();
+    return Admission::Queued;
+  }
+
+  if (bucket.pending >= MAX_PER_CLIENT || _commands.full()) {
+    _stats.droppedQueueFull++;
+    return Admission::QueueFull;
+  }
+  if (!_takeToken(bucket, now)) {
+    _stats.droppedRateLimited++;
+    return Admission::RateLimited;
+  }
+
+  bucket.pending++;
+  _commands.push(entry);
+  _stats.queued++;
+  _updateDepth();
+
+  return Admission::Queued;
+}
+
+bool CommandQueue::admit(std::uint8_t clientId, std::uint32_t now) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return false;
+  }
+
+  if (!_takeToken(_buckets[clientId], now)) {
+    _stats.droppedRateLimited++;
+    return false;
+  }
+  return true;
+}
+
+bool CommandQueue::pop(Entry& entry) {
+  if (_stops.count > 0) {
+    _stops.pop(entry);
+    if (entry.clientId != NO_CLIENT) {
+      _buckets[entry.clientId].stops--;
+    }
+  } else if (_commands.count > 0) {
+    _commands.pop(entry);
+    _buckets[entry.clientId].pending--;
+  } else {
+    return false;
+  }
+
+  _updateDepth();
+  return true;
+}
+
+void CommandQueue::removeClient(std::uint8_t clientId) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+
+  _stats.droppedDisconnected += _removeCommands([clientId](const Entry& queued) { return queued.clientId == clientId; });
+
+  // Its stops still run, a collar the client started shouldn't keep going because the client went away
+  for (std::size_t i = 0; i < _stops.count; ++i) {
+    if (_stops.at(i).clientId == clientId) {
+      _stops.at(i).clientId = NO_CLIENT;
+    }
+  }
+
+  _buckets[clientId] = {BUCKET_SIZE, 0, 0, 0};
+  _updateDepth();
+}
+
+bool CommandQueue::_takeToken(Bucket& bucket, std::uint32_t now) {
+  std::uint32_t refill = (now - bucket.lastRefill) / TOKEN_INTERVAL_MS;
+  if (refill > 0) {
+    std::uint32_t missing = BUCKET_SIZE - bucket.tokens;
+    bucket.tokens         = refill >= missing ? BUCKET_SIZE : bucket.tokens + refill;
+    bucket.lastRefill     = bucket.lastRefill + refill * TOKEN_INTERVAL_MS;
+  }
+  if (bucket.tokens == BUCKET_SIZE) {
+    // A full bucket doesn't bank time, otherwise an idle client could burst past the bucket size
+    bucket.lastRefill = now;
+  }
+
+  if (bucket.tokens == 0) {
+    return false;
+  }
+
+  bucket.tokens--;
+  return true;
+}
+
+template<typename Predicate>
+std::size_t CommandQueue::_removeCommands(Predicate predicate) {
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < _commands.count; ++i) {
+    Entry& queued = _commands.at(i);
+    if (predicate(queued)) {
+      _buckets[queued.clientId].pending--;
+    } else {
+      _commands.at(kept++) = queued;
+    }
+  }
+
+  std::size_t removed = _commands.count - kept;
+  _commands.count     = kept;
+  return removed;
+}
+
+void CommandQueue::_updateDepth() {
+  _stats.depth = depth();
+  if (_stats.depth > _stats.maxDepth) {
+    _stats.maxDepth = _stats.depth;
+  }
+}
@@ -0,0 +1,36 @@
+#include "crypto-msgpack.hpp"
+
+#include "crypto-io.hpp"
+#include "logger.hpp"
+
+bool ReadEncryptedMsgPackFile(const char* name, DynamicJsonDocument& doc) {
+  auto file = CryptoFileReader(name);
+  if (!file) {
+    Logger::printlnf("Failed to open \"%s\"", name);
+    return false;
+  }
+  
+  auto err = deserializeMsgPack(doc, file);
+  if (err) {
+    Logger::printlnf("Failed to deserialize \"%s\": %s", name, err.c_str());
+    return false;
+  }
+
+  return file.close();
+}
+
+bool WriteEncryptedMsgPackFile(const char* name, const DynamicJsonDocument& doc) {
+  auto file = CryptoFileWriter(name);
+  if (!file) {
+    Logger::printlnf("Failed to open \"%s\"", name);
+    return false;
+  }
+  
+  std::size_t nRead = serializeMsgPack(doc, file);
+  if (nRead == 0) {
+    Logger::printlnf("Failed to serialize \"%s\"", name);
+    return false;
+  }
+
+  return file.close();
+}
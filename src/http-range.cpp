@@ -0,0 +1,96 @@
+#include "http-range.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+constexpr const char* RANGE_UNIT_PREFIX = "bytes=";
+
+bool ParseUnsigned(const char*& str, std::size_t& value) {
+  if (*str < '0' || *str > '9') {
+    return false;
+  }
+
+  value = 0;
+  while (*str >= '0' && *str <= '9') {
+    std::size_t digit = *str - '0';
+    if (value > (SIZE_MAX - digit) / 10) {
+      return false;  // Overflow
+    }
+    value = value * 10 + digit;
+    ++str;
+  }
+
+  return true;
+}
+
+void SkipWhitespace(const char*& str) {
+  while (*str == ' ' || *str == '\t') {
+    ++str;
+  }
+}
+
+HttpRangeSet::ParseResult HttpRangeSet::parse(const char* header, std::size_t fileSize) {
+  _count = 0;
+
+  if (header == nullptr || std::strncmp(header, RANGE_UNIT_PREFIX, std::strlen(RANGE_UNIT_PREFIX)) != 0) {
+    return ParseResult::None;
+  }
+
+  const char* str = header + std::strlen(RANGE_UNIT_PREFIX);
+
+  while (true) {
+    SkipWhitespace(str);
+
+    std::size_t first = 0;
+    std::size_t last  = 0;
+
+    bool hasFirst = ParseUnsigned(str, first);
+    if (*str++ != '-') {
+      _count = 0;
+      return ParseResult::None;
+    }
+    bool hasLast = ParseUnsigned(str, last);
+
+    if (!hasFirst && !hasLast) {
+      _count = 0;
+      return ParseResult::None;
+    }
+    if (hasFirst && hasLast && last < first) {
+      _count = 0;
+      return ParseResult::None;
+    }
+
+    // Resolve the range against the file, silently dropping ranges that fall outside it
+    if (!hasFirst) {
+      // Suffix range, the last N bytes of the file
+      if (last > 0 && fileSize > 0) {
+        std::size_t length = last < fileSize ? last : fileSize;
+        if (_count == MAX_RANGES) {
+          _count = 0;
+          return ParseResult::None;
+        }
+        _ranges[_count++] = {fileSize - length, length};
+      }
+    } else if (first < fileSize) {
+      if (!hasLast || last >= fileSize) {
+        last = fileSize - 1;
+      }
+      if (_count == MAX_RANGES) {
+        _count = 0;
+        return ParseResult::None;
+      }
+      _ranges[_count++] = {first, last - first + 1};
+    }
+
+    SkipWhitespace(str);
+    if (*str == '\0') {
+      break;
+    }
+    if (*str++ != ',') {
+      _count = 0;
+      return ParseResult::None;
+    }
+  }
+
+  return _count > 0 ? ParseResult::Satisfiable : ParseResult::Unsatisfiable;
+}
@@ -0,0 +1,202 @@
+#include "http-transfer.hpp"
+
+#include <Arduino.h>
+
+constexpr const char* PART_HEADER_FORMAT = "\r\n--ZAPME_BYTERANGES\r\nContent-Type: %s\r\nContent-Range: bytes %u-%u/%u\r\n\r\n";
+constexpr const char* PART_FOOTER        = "\r\n--ZAPME_BYTERANGES--\r\n";
+constexpr std::size_t PART_HEADER_MAX    = 160;
+
+HttpTransfer::HttpTransfer()
+  : _client()
+  , _file()
+  , _entry(nullptr)
+  , _ranges()
+  , _contentType(nullptr)
+  , _size(0)
+  , _rangeIndex(0)
+  , _position(0)
+  , _remaining(0)
+  , _bytesSent(0)
+  , _startMicros(0)
+  , _busyMicros(0)
+  , _maxStepMicros(0)
+  , _lastProgressMillis(0)
+  , _state(State::Idle) { }
+
+void HttpTransfer::begin(const WiFiClient& client, SDCardFile&& file, const char* contentType, const HttpRangeSet& ranges) {
+  _file  = std::move(file);
+  _entry = nullptr;
+  _start(client, contentType, _file.size(), ranges);
+}
+
+void HttpTransfer::begin(const WiFiClient& client, const AssetCache::Entry& entry, const HttpRangeSet& ranges) {
+  _entry = &entry;
+  _start(client, entry.contentType, entry.size, ranges);
+}
+
+void HttpTransfer::_start(const WiFiClient& client, const char* contentType, std::size_t size, const HttpRangeSet& ranges) {
+  _client             = client;
+  _ranges             = ranges;
+  _contentType        = contentType;
+  _size               = size;
+  _bytesSent          = 0;
+  _startMicros        = micros();
+  _busyMicros         = 0;
+  _maxStepMicros      = 0;
+  _lastProgressMillis = millis();
+
+  if (_ranges.count() > 1) {
+    _rangeIndex = 0;
+    _state      = State::PartHeader;
+    return;
+  }
+
+  if (_ranges.count() == 1) {
+    _state = _enterRange(0) ? State::Body : State::Failed;
+    return;
+  }
+
+  _position  = 0;
+  _remaining = _size;
+  _state     = (_entry != nullptr || _file.seekBeg(0)) ? State::Body : State::Failed;
+}
+
+bool HttpTransfer::pump(std::uint8_t* buffer, std::size_t chunkSize) {
+  if (!active()) {
+    return false;
+  }
+
+  if (!_client.connected()) {
+    _state = State::Failed;
+    return false;
+  }
+
+  std::size_t writable = _client.availableForWrite();
+  if (writable == 0) {
+    if (millis() - _lastProgressMillis > STALL_TIMEOUT_MS) {
+      _state = State::Failed;
+      return false;
+    }
+    return true;
+  }
+
+  std::uint32_t stepStart = micros();
+  bool progressed         = false;
+
+  switch (_state) {
+    case State::PartHeader:
+      {
+        const HttpRange& range = _ranges[_rangeIndex];
+
+        char header[PART_HEADER_MAX];
+        int len = snprintf(header, sizeof(header), PART_HEADER_FORMAT, _contentType, range.start, range.last(), _size);
+        progressed = _writeText(header, len, writable);
+        if (progressed) {
+          _state = _enterRange(_rangeIndex) ? State::Body : State::Failed;
+        }
+      }
+      break;
+    case State::Body:
+      progressed = _writeBody(buffer, chunkSize, writable);
+      if (progressed && _remaining == 0) {
+        if (_ranges.count() > 1 && ++_rangeIndex < _ranges.count()) {
+          _state = State::PartHeader;
+        } else if (_ranges.count() > 1) {
+          _state = State::Footer;
+        } else {
+          _state = State::Done;
+        }
+      }
+      break;
+    case State::Footer:
+      progressed = _writeText(PART_FOOTER, std::strlen(PART_FOOTER), writable);
+      if (progressed) {
+        _state = State::Done;
+      }
+      break;
+    default:
+      break;
+  }
+
+  std::uint32_t stepMicros = micros() - stepStart;
+  _busyMicros += stepMicros;
+  _maxStepMicros = std::max(_maxStepMicros, stepMicros);
+
+  if (progressed) {
+    _lastProgressMillis = millis();
+  } else if (millis() - _lastProgressMillis > STALL_TIMEOUT_MS) {
+    _state = State::Failed;
+  }
+
+  return active();
+}
+
+void HttpTransfer::reset() {
+  _client = WiFiClient();
+  _file.close();
+  _entry = nullptr;
+  _state = State::Idle;
+}
+
+std::size_t HttpTransfer::MultipartLength(const char* contentType, std::size_t size, const HttpRangeSet& ranges) {
+  std::size_t length = std::strlen(PART_FOOTER);
+  for (const HttpRange& range : ranges) {
+    length += snprintf(nullptr, 0, PART_HEADER_FORMAT, contentType, range.start, range.last(), size);
+    length += range.length;
+  }
+  return length;
+}
+
+bool HttpTransfer::_enterRange(std::size_t index) {
+  const HttpRange& range = _ranges[index];
+
+  _position  = range.start;
+  _remaining = range.length;
+
+  return _entry != nullptr || _file.seekBeg(_position);
+}
+
+bool HttpTransfer::_writeText(const char* text, std::size_t length, std::size_t writable) {
+  // Part headers are tiny, wait until they fit in one go instead of tracking partial writes
+  if (writable < length) {
+    return false;
+  }
+
+  if (_client.write(reinterpret_cast<const std::uint8_t*>(text), length) != length) {
+    _state = State::Failed;
+    return false;
+  }
+
+  _bytesSent += length;
+  return true;
+}
+
+bool HttpTransfer::_writeBody(std::uint8_t* buffer, std::size_t chunkSize, std::size_t writable) {
+  std::size_t length = std::min(_remaining, std::min(chunkSize, writable));
+
+  if (_entry != nullptr) {
+    if (_client.write(_entry->data.get() + _position, length) != length) {
+      _state = State::Failed;
+      return false;
+    }
+  } else {
+    // Keep SD reads sector-aligned, a read only stops mid-sector at the end of the span or when the socket is nearly full
+    std::size_t toBoundary = SD_SECTOR_SIZE - (_position & (SD_SECTOR_SIZE - 1));
+    if (length < _remaining && length > toBoundary) {
+      length = toBoundary + ((length - toBoundary) & ~(SD_SECTOR_SIZE - 1));
+    }
+
+    std::size_t nRead = _file.read(buffer, length);
+    if (nRead == 0 || _client.write(buffer, nRead) != nRead) {
+      _state = State::Failed;
+      return false;
+    }
+    length = nRead;
+  }
+
+  _position += length;
+  _remaining -= length;
+  _bytesSent += length;
+
+  return true;
+}
@@ -0,0 +1,272 @@
+#include "json-command-parser.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+struct JsonEnumValue {
+  const char* name;
+  std::uint8_t value;
+};
+
+struct JsonFieldSpec {
+  const char* key;
+  std::uint32_t min;
+  std::uint32_t max;
+  const JsonEnumValue* enumValues;  // String values allowed for this field, nullptr if it only takes integers
+  std::size_t enumCount;
+};
+
+enum JsonField : std::uint8_t {
+  FIELD_VERSION,
+  FIELD_OP,
+  FIELD_SEQUENCE,
+  FIELD_TRANSMITTER_ID,
+  FIELD_CHANNEL,
+  FIELD_COMMAND,
+  FIELD_STRENGTH,
+  FIELD_DURATION,
+  FIELD_COUNT,
+};
+
+constexpr std::uint8_t OP_COMMAND     = 0;
+constexpr std::uint8_t OP_STOP        = 1;
+constexpr std::uint8_t OP_SUBSCRIBE   = 2;
+constexpr std::uint8_t OP_UNSUBSCRIBE = 3;
+constexpr std::uint8_t OP_COUNT       = 4;
+
+constexpr JsonEnumValue OP_VALUES[OP_COUNT] = {
+  {  "cmd",     OP_COMMAND},
+  { "stop",        OP_STOP},
+  {  "sub",   OP_SUBSCRIBE},
+  {"unsub", OP_UNSUBSCRIBE},
+};
+
+constexpr JsonEnumValue COMMAND_VALUES[] = {
+  {  "shock",   static_cast<std::uint8_t>(Command::Shock)},
+  {"vibrate", static_cast<std::uint8_t>(Command::Vibrate)},
+  {   "beep",    static_cast<std::uint8_t>(Command::Beep)},
+};
+
+constexpr std::uint32_t CHANNEL_MIN = static_cast<std::uint32_t>(Channel::_Min);
+constexpr std::uint32_t CHANNEL_MAX = static_cast<std::uint32_t>(Channel::_Max);
+constexpr std::uint32_t COMMAND_MIN = static_cast<std::uint32_t>(Command::_Min);
+constexpr std::uint32_t COMMAND_MAX = static_cast<std::uint32_t>(Command::_Max);
+
+constexpr JsonFieldSpec FIELDS[FIELD_COUNT] = {
+  {  "v", WsProtocol::VERSION, WsProtocol::VERSION,        nullptr, 0},
+  { "op",                   0,                   0,      OP_VALUES, OP_COUNT},
+  {"seq",                   0,              0xFFFF,        nullptr, 0},
+  { "id",                   0,              0xFFFF,        nullptr, 0},
+  { "ch",         CHANNEL_MIN,         CHANNEL_MAX,        nullptr, 0},
+  {"cmd",         COMMAND_MIN,         COMMAND_MAX, COMMAND_VALUES, 3},
+  {"str",                   0,                  99,        nullptr, 0},
+  {"dur",                   0,              0xFFFF,        nullptr, 0},
+};
+
+constexpr std::uint16_t FieldBit(JsonField field) {
+  return static_cast<std::uint16_t>(1U << field);
+}
+
+// Per-op schema, which fields must be present and which may be present
+constexpr std::uint16_t COMMAND_REQUIRED = FieldBit(FIELD_OP) | FieldBit(FIELD_TRANSMITTER_ID) | FieldBit(FIELD_CHANNEL)
+                                         | FieldBit(FIELD_COMMAND) | FieldBit(FIELD_STRENGTH);
+constexpr std::uint16_t COMMAND_ALLOWED  = COMMAND_REQUIRED | FieldBit(FIELD_VERSION) | FieldBit(FIELD_SEQUENCE)
+                                         | FieldBit(FIELD_DURATION);
+constexpr std::uint16_t STOP_REQUIRED    = FieldBit(FIELD_OP) | FieldBit(FIELD_TRANSMITTER_ID) | FieldBit(FIELD_CHANNEL);
+constexpr std::uint16_t STOP_ALLOWED     = STOP_REQUIRED | FieldBit(FIELD_VERSION) | FieldBit(FIELD_SEQUENCE);
+constexpr std::uint16_t HEADER_REQUIRED  = FieldBit(FIELD_OP);
+constexpr std::uint16_t HEADER_ALLOWED   = HEADER_REQUIRED | FieldBit(FIELD_VERSION) | FieldBit(FIELD_SEQUENCE);
+
+struct JsonOpSchema {
+  WsProtocol::Opcode opcode;
+  std::uint16_t required;
+  std::uint16_t allowed;
+};
+
+// Indexed by the OP_* values
+constexpr JsonOpSchema OP_SCHEMAS[OP_COUNT] = {
+  {    WsProtocol::Opcode::Command, COMMAND_REQUIRED, COMMAND_ALLOWED},
+  {       WsProtocol::Opcode::Stop,    STOP_REQUIRED,    STOP_ALLOWED},
+  {  WsProtocol::Opcode::Subscribe,  HEADER_REQUIRED,  HEADER_ALLOWED},
+  {WsProtocol::Opcode::Unsubscribe,  HEADER_REQUIRED,  HEADER_ALLOWED},
+};
+
+static_assert(FIELD_COUNT <= 16, "Field bitmask is 16 bits wide");
+
+class JsonCursor {
+public:
+  JsonCursor(const char* data, std::size_t length) : _pos(data), _end(data + length) { }
+
+  void skipWhitespace() {
+    while (_pos < _end && (*_pos == ' ' || *_pos == '\t' || *_pos == '\r' || *_pos == '\n')) {
+      ++_pos;
+    }
+  }
+
+  bool consume(char c) {
+    skipWhitespace();
+    if (_pos < _end && *_pos == c) {
+      ++_pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool peek(char c) {
+    skipWhitespace();
+    return _pos < _end && *_pos == c;
+  }
+
+  bool atEnd() {
+    skipWhitespace();
+    return _pos == _end;
+  }
+
+  // Reads a string without escapes into the buffer, fails if it doesn't fit
+  bool readString(char* buffer, std::size_t size, std::size_t& length) {
+    if (!consume('"')) {
+      return false;
+    }
+    length = 0;
+    while (_pos < _end && *_pos != '"') {
+      if (*_pos == '\\' || static_cast<std::uint8_t>(*_pos) < 0x20 || length + 1 >= size) {
+        return false;
+      }
+      buffer[length++] = *_pos++;
+    }
+    if (_pos == _end) {
+      return false;
+    }
+    ++_pos;
+    buffer[length] = '\0';
+    return true;
+  }
+
+  // Reads an unsigned integer, fails as soon as it exceeds max
+  bool readUnsigned(std::uint32_t max, std::uint32_t& value) {
+    skipWhitespace();
+    if (_pos == _end || *_pos < '0' || *_pos > '9') {
+      return false;
+    }
+    value = 0;
+    while (_pos < _end && *_pos >= '0' && *_pos <= '9') {
+      value = value * 10 + (*_pos++ - '0');
+      if (value > max) {
+        return false;
+      }
+    }
+    // Fractions and exponents are not part of the schema
+    return _pos == _end || (*_pos != '.' && *_pos != 'e' && *_pos != 'E');
+  }
+
+private:
+  const char* _pos;
+  const char* _end;
+};
+
+WsProtocol::Status JsonCommandParser::Parse(const char* data, std::size_t length, WsProtocol::Message& message) {
+  message.sequence = 0;
+
+  if (length > MAX_MESSAGE_SIZE) {
+    return WsProtocol::Status::Malformed;
+  }
+
+  JsonCursor cursor(data, length);
+  if (!cursor.consume('{')) {
+    return WsProtocol::Status::Malformed;
+  }
+
+  std::uint32_t values[FIELD_COUNT] = {};
+  std::uint16_t present             = 0;
+
+  bool first = true;
+  while (!cursor.consume('}')) {
+    if (!first && !cursor.consume(',')) {
+      return WsProtocol::Status::Malformed;
+    }
+    first = false;
+
+    char key[MAX_KEY_LEN + 1];
+    std::size_t keyLen;
+    if (!cursor.readString(key, sizeof(key), keyLen) || !cursor.consume(':')) {
+      return WsProtocol::Status::Malformed;
+    }
+
+    std::size_t field = 0;
+    while (field < FIELD_COUNT && std::strcmp(FIELDS[field].key, key) != 0) {
+      ++field;
+    }
+    if (field == FIELD_COUNT || (present & (1U << field)) != 0) {
+      return WsProtocol::Status::Malformed;
+    }
+
+    const JsonFieldSpec& spec = FIELDS[field];
+    if (field == FIELD_VERSION) {
+      // Any other version, numeric or not, is reported as unsupported rather than malformed
+      if (!cursor.readUnsigned(spec.max, values[field]) || values[field] < spec.min) {
+        return WsProtocol::Status::UnsupportedVersion;
+      }
+    } else if (cursor.peek('"')) {
+      char value[MAX_STRING_LEN + 1];
+      std::size_t valueLen;
+      if (spec.enumValues == nullptr || !cursor.readString(value, sizeof(value), valueLen)) {
+        return WsProtocol::Status::Malformed;
+      }
+
+      std::size_t i = 0;
+      while (i < spec.enumCount && std::strcmp(spec.enumValues[i].name, value) != 0) {
+        ++i;
+      }
+      if (i == spec.enumCount) {
+        return WsProtocol::Status::InvalidCommand;
+      }
+      values[field] = spec.enumValues[i].value;
+    } else {
+      // Enum-only fields like "op" have max 0 and are never given as numbers
+      if (field == FIELD_OP || !cursor.readUnsigned(spec.max, values[field])) {
+        return WsProtocol::Status::Malformed;
+      }
+      if (values[field] < spec.min) {
+        return WsProtocol::Status::InvalidCommand;
+      }
+    }
+
+    present |= static_cast<std::uint16_t>(1U << field);
+
+    if (field == FIELD_SEQUENCE) {
+      message.sequence = static_cast<std::uint16_t>(values[field]);
+    }
+  }
+
+  if (!cursor.atEnd() || (present & FieldBit(FIELD_OP)) == 0) {
+    return WsProtocol::Status::Malformed;
+  }
+
+  const JsonOpSchema& schema = OP_SCHEMAS[values[FIELD_OP]];
+  if ((present & schema.required) != schema.required || (present & ~schema.allowed) != 0) {
+    return WsProtocol::Status::Malformed;
+  }
+
+  message.opcode        = schema.opcode;
+  message.patternLoops  = 0;
+  message.keyframeCount = 0;
+  message.keyframes     = nullptr;
+
+  CollarCommand& command = message.command;
+  command.action         = values[FIELD_OP] == OP_COMMAND ? CollarAction::Transmit : CollarAction::Stop;
+  command.transmitterId  = static_cast<std::uint16_t>(values[FIELD_TRANSMITTER_ID]);
+  command.channel        = static_cast<Channel>(values[FIELD_CHANNEL]);
+  command.command        = static_cast<Command>(values[FIELD_COMMAND]);
+  command.strength       = static_cast<std::uint8_t>(values[FIELD_STRENGTH]);
+  command.durationMs     = static_cast<std::uint16_t>(values[FIELD_DURATION]);
+
+  return WsProtocol::Status::Ok;
+}
+
+std::size_t JsonCommandParser::EncodeAck(std::uint16_t sequence, WsProtocol::Status status, char* buffer, std::size_t size) {
+  int len = snprintf(buffer, size, "{\"ack\":%u,\"status\":%u}", sequence, static_cast<std::uint8_t>(status));
+  if (len < 0 || static_cast<std::size_t>(len) >= size) {
+    return 0;
+  }
+  return len;
+}
@@ -0,0 +1,140 @@
+#include "link-monitor.hpp"
+
+#include <limits>
+
+LinkMonitor::LinkMonitor() : _clients() { }
+
+void LinkMonitor::connect(std::uint8_t clientId, std::uint32_t now) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+
+  _clients[clientId]           = {};
+  _clients[clientId].connected = true;
+  _clients[clientId].lastHeard = now;
+  _clients[clientId].lastPing  = now;
+}
+
+void LinkMonitor::disconnect(std::uint8_t clientId) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+
+  _clients[clientId].connected = false;
+}
+
+void LinkMonitor::heard(std::uint8_t clientId, std::uint32_t now) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+
+  _clients[clientId].lastHeard = now;
+}
+
+void LinkMonitor::update(std::uint32_t now, Actions& actions) {
+  actions = {};
+
+  for (std::uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; ++i) {
+    Client& client = _clients[i];
+    if (!client.connected) {
+      continue;
+    }
+
+    if (now - client.lastHeard > SILENCE_TIMEOUT_MS) {
+      actions.drop |= 1UL << i;
+      client.connected = false;
+    } else if (now - client.lastPing >= PING_INTERVAL_MS) {
+      actions.ping |= 1UL << i;
+      client.lastPing = now;
+    }
+  }
+}
+
+void LinkMonitor::encodePing(std::uint8_t* payload, std::uint32_t nowMicros) const {
+  for (std::size_t i = 0; i < PING_PAYLOAD_SIZE; ++i) {
+    payload[i] = static_cast<std::uint8_t>(nowMicros >> (i * 8));
+  }
+}
+
+bool LinkMonitor::pong(std::uint8_t clientId,
+                       const std::uint8_t* payload,
+                       std::size_t length,
+                       std::uint32_t nowMicros,
+                       std::uint32_t now) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return false;
+  }
+
+  Client& client   = _clients[clientId];
+  client.lastHeard = now;
+
+  // Unsolicited pongs don't carry one of our timestamps
+  if (length != PING_PAYLOAD_SIZE) {
+    return false;
+  }
+
+  std::uint32_t sentMicros = 0;
+  for (std::size_t i = 0; i < PING_PAYLOAD_SIZE; ++i) {
+    sentMicros |= static_cast<std::uint32_t>(payload[i]) << (i * 8);
+  }
+
+  std::uint32_t rttMs = (nowMicros - sentMicros) / 1000;
+  if (rttMs > std::numeric_limits<std::uint16_t>::max()) {
+    rttMs = std::numeric_limits<std::uint16_t>::max();
+  }
+
+  std::size_t bucket = 0;
+  while (bucket < BUCKET_COUNT - 1 && rttMs > BUCKET_BOUNDS_MS[bucket]) {
+    ++bucket;
+  }
+
+  // Halve everything before a counter saturates, older samples fade out and the percentiles follow the link
+  if (client.counts[bucket] == std::numeric_limits<std::uint16_t>::max()) {
+    client.samples = 0;
+    for (std::uint16_t& count : client.counts) {
+      count /= 2;
+      client.samples += count;
+    }
+  }
+
+  client.counts[bucket]++;
+  client.samples++;
+  client.lastMs = static_cast<std::uint16_t>(rttMs);
+  if (client.lastMs > client.maxMs) {
+    client.maxMs = client.lastMs;
+  }
+
+  if (++client.pongsSinceReport < REPORT_INTERVAL) {
+    return false;
+  }
+
+  client.pongsSinceReport = 0;
+  return true;
+}
+
+LinkMonitor::Report LinkMonitor::report(std::uint8_t clientId) const {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return {};
+  }
+
+  const Client& client = _clients[clientId];
+  return {client.lastMs, _percentile(client, 500), _percentile(client, 990), client.samples};
+}
+
+std::uint16_t LinkMonitor::_percentile(const Client& client, std::uint32_t permille) {
+  if (client.samples == 0) {
+    return 0;
+  }
+
+  std::uint32_t rank       = (static_cast<std::uint32_t>(client.samples) * permille + 999) / 1000;
+  std::uint32_t cumulative = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT - 1; ++i) {
+    cumulative += client.counts[i];
+    if (cumulative >= rank) {
+      return BUCKET_BOUNDS_MS[i] < client.maxMs ? BUCKET_BOUNDS_MS[i] : client.maxMs;
+    }
+  }
+
+  // The last bucket is open-ended
+  return client.maxMs;
+}
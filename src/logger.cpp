@@ -1,8 +1,11 @@
 #include "logger.hpp"
 
+#include "ntp-client.hpp"
 #include "resizable-buffer.hpp"
 #include "sdcard.hpp"
 
+#include <ctime>
+
 #define LOG_TO_SERIAL true
 #define SERIAL_BEGIN(...)      \
   if (LOG_TO_SERIAL) {         \
@@ -50,7 +53,8 @@
   file.write(buf, len);           \
   file.write("\r\n", 2)
 
-char* LogPath = nullptr;
+char* LogPath              = nullptr;
+const NtpClient* LogClock = nullptr;
 
 bool InitializeLogPath() {
   static char FileName[40] {0};
@@ -164,6 +168,10 @@ Logger::InitializationError Logger::Initialize() {
   return InitializationError::None;
 }
 
+void Logger::SetClock(const NtpClient* clock) {
+  LogClock = clock;
+}
+
 #define GET_FILE                                                     \
   if (LogPath == nullptr) {                                          \
     if (Logger::Initialize() != Logger::InitializationError::None) { \
@@ -176,9 +184,38 @@ Logger::InitializationError Logger::Initialize() {
   }
 
 constexpr const char* TS_FORMAT         = "[%02hu:%02hhu:%02hhu:%02hhu.%03hu] ";
-constexpr std::size_t TS_FORMAT_MAX_LEN = 20;
+constexpr const char* TS_EPOCH_FORMAT   = "[%Y-%m-%d %H:%M:%S";
+constexpr std::size_t TS_FORMAT_MAX_LEN = 26;  // "[2026-01-01 00:00:00.000] "
+
+// Uptime, or UTC if the clock is valid
+struct LogTime {
+  std::uint64_t millis;
+  bool epoch;
+};
+
+LogTime CurrentTime() {
+  if (LogClock != nullptr && LogClock->isTimeValid()) {
+    return {LogClock->getEpochMillis(), true};
+  }
+  return {millis(), false};
+}
+
+int FormatTimestamp(char* buffer, std::size_t bufferSize, const LogTime& time) {
+  std::uint64_t millis = time.millis;
+
+  if (time.epoch) {
+    time_t seconds = static_cast<time_t>(millis / 1000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+
+    std::size_t length = strftime(buffer, bufferSize, TS_EPOCH_FORMAT, &utc);
+    if (length == 0) {
+      return -1;
+    }
+    int msLen = snprintf(buffer + length, bufferSize - length, ".%03u] ", static_cast<std::uint32_t>(millis % 1000));
+    return msLen < 0 ? msLen : static_cast<int>(length) + msLen;
+  }
 
-int FormatTimestamp(char* buffer, std::size_t bufferSize, std::uint64_t millis) {
   std::uint64_t seconds = millis / 1000;
   millis -= seconds * 1000;
 
@@ -201,21 +238,21 @@ int FormatTimestamp(char* buffer, std::size_t bufferSize, std::uint64_t millis)
                   static_cast<std::uint16_t>(millis));
 }
 
-int PrintTimestamp(SDCardFile& file, std::uint64_t millis) {
+int PrintTimestamp(SDCardFile& file, const LogTime& time) {
   char buffer[32];
-  int tsLen = FormatTimestamp(buffer, sizeof(buffer), millis);
+  int tsLen = FormatTimestamp(buffer, sizeof(buffer), time);
   if (tsLen <= 0) return tsLen;
   LOGGER_WRITE(buffer, tsLen);
   return tsLen;
 }
 
 void Logger::vprintlnf(const char* format, va_list args) {
-  std::uint64_t milli = millis();
+  LogTime time = CurrentTime();
   GET_FILE
 
   ResizableBuffer<char, 64> buffer = ResizableBuffer<char, 64>();
 
-  int tsLen = FormatTimestamp(buffer.ptr(), buffer.size(), milli);
+  int tsLen = FormatTimestamp(buffer.ptr(), buffer.size(), time);
   if (tsLen <= 0) {
     return;
   }
@@ -225,7 +262,7 @@ void Logger::vprintlnf(const char* format, va_list args) {
   if (len > static_cast<int>(buffer.size()) - 1) {
     buffer.resize(len + 1);
 
-    tsLen = FormatTimestamp(buffer.ptr(), len + 1, milli);
+    tsLen = FormatTimestamp(buffer.ptr(), len + 1, time);
     if (tsLen <= 0) {
       return;
     }
@@ -239,12 +276,12 @@ void Logger::vprintlnf(const char* format, va_list args) {
 }
 
 void Logger::printlnf(const char* format, ...) {
-  std::uint64_t milli = millis();
+  LogTime time = CurrentTime();
   GET_FILE
 
   ResizableBuffer<char, 64> buffer = ResizableBuffer<char, 64>();
 
-  int tsLen = FormatTimestamp(buffer.ptr(), buffer.size(), milli);
+  int tsLen = FormatTimestamp(buffer.ptr(), buffer.size(), time);
   if (tsLen <= 0) {
     return;
   }
@@ -258,7 +295,7 @@ void Logger::printlnf(const char* format, ...) {
   if (len > static_cast<int>(buffer.size()) - 1) {
     buffer.resize(len + 1);
 
-    tsLen = FormatTimestamp(buffer.ptr(), len + 1, milli);
+    tsLen = FormatTimestamp(buffer.ptr(), len + 1, time);
     if (tsLen <= 0) {
       return;
     }
@@ -274,9 +311,9 @@ void Logger::printlnf(const char* format, ...) {
 }
 
 void Logger::println(const String& message) {
-  std::uint64_t milli = millis();
+  LogTime time = CurrentTime();
   GET_FILE
-  int tsLen = PrintTimestamp(file, milli);
+  int tsLen = PrintTimestamp(file, time);
   if (tsLen <= 0) {
     return;
   }
@@ -285,9 +322,9 @@ void Logger::println(const String& message) {
 
 void Logger::println(const char* message) {
   if (message == nullptr || message[0] == '\0') return;
-  std::uint64_t milli = millis();
+  LogTime time = CurrentTime();
   GET_FILE
-  int tsLen = PrintTimestamp(file, milli);
+  int tsLen = PrintTimestamp(file, time);
   if (tsLen <= 0) {
     return;
   }
@@ -327,7 +364,7 @@ void _printhexln(const char* message, const std::uint8_t* data, std::size_t size
     return;
   }
 
-  std::uint64_t milli = millis();
+  LogTime time = CurrentTime();
   GET_FILE
 
   std::size_t strLen = 0;
@@ -339,7 +376,7 @@ void _printhexln(const char* message, const std::uint8_t* data, std::size_t size
   std::size_t bufferSize = TS_FORMAT_MAX_LEN + strLen + hexLen + 2;
   char* buffer           = new char[bufferSize];
 
-  int tsLen = FormatTimestamp(buffer, bufferSize, milli);
+  int tsLen = FormatTimestamp(buffer, bufferSize, time);
   if (tsLen <= 0 || static_cast<std::size_t>(tsLen) > TS_FORMAT_MAX_LEN) {
     delete[] buffer;
     return;
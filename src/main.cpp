@@ -1,17 +1,22 @@
-#include "crypto-io.hpp"
+#include "crypto-msgpack.hpp"
 #include "crypto-utils.hpp"
 #include "logger.hpp"
 #include "ntp-client.hpp"
+#include "rf-transmitter.hpp"
 #include "sdcard.hpp"
 #include "serializers/caixianlin-serialize.hpp"
 #include "webservices.hpp"
 #include "wifi-ap.hpp"
+#include "wifi-sta.hpp"
 
 #include <ArduinoJson.h>
 #include <ESP8266mDNS.h>
 #include <ESP8266WiFiMulti.h>
 
+constexpr std::uint8_t RF_TX_PIN = D1;
+
 NtpClient ntpClient;
+bool ntpRunning = false;
 std::shared_ptr<WebServices> webServices = nullptr;
 
 // Blinks forever in a error pattern
@@ -82,9 +87,24 @@ void InitializeMDNS() {
   }
 }
 
-void InitializeNTP() {
-  Logger::println("Initializing NTP client");
-  ntpClient = NtpClient();
+void InitializeRF() {
+  Logger::println("Initializing RF transmitter");
+  if (!RfTransmitter::Begin(RF_TX_PIN)) {
+    Logger::println("Failed to initialize RF transmitter");
+  }
+}
+
+// Runs before the first log line, after a warm reset every line of the boot is stamped with the restored time
+void RestoreClock() {
+  Logger::SetClock(&ntpClient);
+  ntpClient.restore();
+}
+
+void InitializeStation() {
+  Logger::println("Connecting to WiFi");
+  if (!WiFi_STA::Start()) {
+    Logger::println("Failed to connect to WiFi, retrying in the background");
+  }
 }
 
 void enableAP();
@@ -93,47 +113,17 @@ void setup() {
   InitializeLED();
   InitializeSDCard();
   InitializeLogger();
+  RestoreClock();
   Logger::println("ZapMe starting up");
   InitializeWiFi();
   InitializeMDNS();
-  InitializeNTP();
+  InitializeRF();
+  InitializeStation();
   Logger::println("ZapMe startup complete");
 
   enableAP();
 }
 
-bool ReadEncryptedMsgPackFile(const char* name, DynamicJsonDocument& doc) {
-  auto file = CryptoFileReader(name);
-  if (!file) {
-    Logger::printlnf("Failed to open \"%s\"", name);
-    return false;
-  }
-  
-  auto err = deserializeMsgPack(doc, file);
-  if (err) {
-    Logger::printlnf("Failed to deserialize \"%s\": %s", name, err.c_str());
-    return false;
-  }
-
-  return file.close();
-}
-
-bool WriteEncryptedMsgPackFile(const char* name, const DynamicJsonDocument& doc) {
-  auto file = CryptoFileWriter(name);
-  if (!file) {
-    Logger::printlnf("Failed to open \"%s\"", name);
-    return false;
-  }
-  
-  std::size_t nRead = serializeMsgPack(doc, file);
-  if (nRead == 0) {
-    Logger::printlnf("Failed to serialize \"%s\"", name);
-    return false;
-  }
-
-  return file.close();
-}
-
 void enableAP() {
   Logger::println("Enabling access point");
 
@@ -179,96 +169,19 @@ void enableAP() {
   Logger::println("Web services started");
 }
 
-void handleScanResult(std::int8_t networksFound) {
-  if (networksFound < 0) {
-    return;
-  }
-
-  if (networksFound == 0) {
-    Logger::println("[WiFi] Scan complete, no networks found");
-  } else {
-    Logger::printlnf("[WiFi] Scan complete, found %d networks:", networksFound);
-
-    for (std::int8_t i = 0; i < networksFound; i++) {
-      Logger::printlnf("[WiFi]     %s", WiFi.SSID(i).c_str());
-    }
-  }
-
-  if (networksFound == 0) {
-    // TODO: enableAP();
-    return;
-  }
-
-  // Connect to the first network from config that we find in the scan results
-  /*
-  std::uint32_t offset = 0;
-  std::uint8_t configNetworkCount;
-  offset += SecureConfig::Read(0, configNetworkCount);
-  for (std::uint8_t i = 0; i < configNetworkCount; i++) {
-    String configNetworkSSID;
-    offset += SecureConfig::Read(offset, configNetworkSSID);
-
-    String configNetworkPassword;
-    offset += SecureConfig::Read(offset, configNetworkPassword);
-
-    for (std::int8_t j = 0; j < networksFound; j++) {
-      if (WiFi.SSID(j) == configNetworkSSID) {
-        Logger::println("[WiFi] Connecting to network from config");
-        WiFi.begin(configNetworkSSID.c_str(), nullptr, i);
-        return;
-      }
+void updateNTP() {
+  if (WiFi_STA::IsConnected() != ntpRunning) {
+    if (ntpRunning) {
+      ntpClient.end();
+      ntpRunning = false;
+    } else {
+      ntpRunning = ntpClient.begin();
     }
   }
-  */
-}
-
-bool startWiFiScan() {
-  switch (WiFi.status()) {
-    case WL_CONNECTED:
-      Logger::println("[WiFi] Disconnecting from WiFi");
-      WiFi.disconnect(false, true);
-      break;
-    case WL_DISCONNECTED:
-      Logger::println("[WiFi] Starting WiFi");
-      WiFi.begin();
-      break;
-    case WL_IDLE_STATUS:
-      break;
-    default:
-      {
-        Logger::printlnf("[WiFi] Cannot start scan, WiFi is busy (status %u)", WiFi.status());
-      }
-      return false;
-  }
 
-  WiFi.scanDelete();
-
-  std::int8_t scanResult = WiFi.scanNetworks(true);
-  if (scanResult == WIFI_SCAN_RUNNING) {
-    Logger::println("[WiFi] Scanning for networks");
-    return true;
-  }
-
-  if (scanResult == WIFI_SCAN_FAILED) {
-    Logger::println("[WiFi] Failed to start scan");
-
-    // TODO: Handle error, update web portal
-
-    return false;
-  }
-
-  handleScanResult(scanResult);
-
-  return true;
-}
-
-void processWiFiScanning() {
-  std::int8_t scanResult = WiFi.scanComplete();
-  if (scanResult < 0) {
-    return;
+  if (ntpRunning) {
+    ntpClient.update();
   }
-
-  handleScanResult(scanResult);
 }
 
 bool highPerformanceMode = false;
@@ -306,6 +219,9 @@ void loop() {
       MDNS.update();
     }
     WiFi_AP::Update();
+    WiFi_STA::Update();
+    updateNTP();
+    WebServices::SetTimeValid(ntpClient.isTimeValid());
     WebServices::Update();
   }
 }
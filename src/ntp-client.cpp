@@ -2,24 +2,99 @@
 
 #include "logger.hpp"
 
+#include <CRC32.h>
 #include <ESP8266WiFi.h>
+#include <lwip/dns.h>
+#include <user_interface.h>
 
 #include <array>
 
+enum class DnsState : std::uint8_t {
+  Idle,
+  Pending,
+  Resolved,  // Set by the lookup callback, reported by update()
+  Failed,
+};
+
 struct NtpServerRecord {
   const char* hostName;
   IPAddress ipAddr;
+  IPAddress lookupAddr;  // Result of the last lookup, taken over by update()
+  DnsState dnsState;
+  std::uint32_t lookupAt;
 };
 
 NtpServerRecord NTP_SERVERS[] = {
-  {       "pool.ntp.org", {}},
-  {      "time.nist.gov", {}},
-  {    "time.google.com", {}},
-  {"time.cloudflare.com", {}},
+  {       "pool.ntp.org", {}, {}, DnsState::Idle, 0},
+  {      "time.nist.gov", {}, {}, DnsState::Idle, 0},
+  {    "time.google.com", {}, {}, DnsState::Idle, 0},
+  {"time.cloudflare.com", {}, {}, DnsState::Idle, 0},
 };
 std::size_t NTP_SERVER_COUNT = sizeof(NTP_SERVERS) / sizeof(NtpServerRecord);
 
-NtpClient::NtpClient() : _udp(), _buffer(), _serverIndex(0), _lastTransmit(0), _lastReceive(0) { }
+static_assert(sizeof(NTP_SERVERS) / sizeof(NtpServerRecord) <= NtpClient::MAX_SERVERS, "Too many NTP servers");
+
+// Clock state kept in RTC user memory across warm resets, a whole number of 4 byte blocks
+struct PersistedClock {
+  std::uint64_t epochMicros;      // Epoch time at rtcTicks
+  std::uint64_t syncEpochMicros;  // Epoch time of the last sync
+  std::uint32_t magic;
+  std::uint32_t rtcTicks;
+  std::uint32_t rtcCalibration;  // RTC tick length in microseconds, 12 fractional bits
+  std::uint32_t uncertaintyMicros;
+  std::int32_t driftPpb;
+  std::uint32_t checksum;
+
+  std::uint32_t calculateChecksum() const {
+    CRC32 crc;
+    crc.update(this, offsetof(PersistedClock, checksum));
+    return crc.finalize();
+  }
+};
+
+constexpr std::uint32_t PERSISTED_CLOCK_MAGIC = 0x4E545031;  // "NTP1"
+
+static_assert(sizeof(PersistedClock) % 4 == 0, "RTC memory is accessed in 4 byte blocks");
+
+void formatEpochMicros(std::uint64_t epochMicros, char (&buffer)[24]) {
+  time_t seconds = static_cast<time_t>(epochMicros / 1'000'000);
+  struct tm utc;
+  gmtime_r(&seconds, &utc);
+
+  std::size_t length = strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &utc);
+  snprintf(buffer + length, sizeof(buffer) - length, ".%03u", static_cast<std::uint32_t>(epochMicros / 1000 % 1000));
+}
+
+// Called by lwIP once a lookup completes, outside of loop(). Only the result is stored, update() acts on it.
+// The server records are static, so a lookup that outlives the client can't write to freed memory
+void handleDnsFound(const char* /* name */, const ip_addr_t* address, void* arg) {
+  NtpServerRecord& record = NTP_SERVERS[reinterpret_cast<std::uintptr_t>(arg)];
+  if (address != nullptr) {
+    record.lookupAddr = IPAddress(address);
+    record.dnsState   = DnsState::Resolved;
+  } else {
+    record.dnsState = DnsState::Failed;
+  }
+}
+
+NtpClient::NtpClient()
+  : _udp()
+  , _buffer()
+  , _servers()
+  , _nextRequest(0)
+  , _bursting(false)
+  , _burstRoundTrip(0)
+  , _requests(0)
+  , _probeIndex(0)
+  , _synced(false)
+  , _restored(false)
+  , _anchor()
+  , _anchorUncertainty(0)
+  , _syncEpochMicros(0)
+  , _nextSave(0)
+  , _driftReference()
+  , _driftPpb(0)
+  , _roundTripMicros(0) { }
 
 NtpClient::~NtpClient() {
   end();
@@ -31,23 +106,24 @@ bool NtpClient::begin() {
     return false;
   }
 
-  // Resolve NTP server names to IP addresses
-  bool anyResolved = false;
-  for (std::size_t i = 0; i < NTP_SERVER_COUNT; ++i) {
-    if (WiFi.hostByName(NTP_SERVERS[i].hostName, NTP_SERVERS[i].ipAddr)) {
-      anyResolved = true;
-    }
-  }
-  if (!anyResolved) {
-    Logger::println("[NTP] Unable to start NTP client: Unable to resolve NTP server names");
-    return false;
-  }
-
   if (_udp.begin(NTP_PORT) != 1) {
     Logger::println("[NTP] Unable to start NTP client: Unable to bind UDP socket");
     return false;
   }
 
+  for (Server& server : _servers) {
+    server.requestMicros = 0;
+    server.retryAt       = millis();
+  }
+  _bursting    = false;
+  _nextRequest = millis();
+
+  // Server names are looked up in the background, requests go out as soon as the first address is known
+  for (std::size_t i = 0; i < NTP_SERVER_COUNT; ++i) {
+    NTP_SERVERS[i].lookupAt = millis();
+  }
+  resolveServers(millis());
+
   return true;
 }
 
@@ -55,42 +131,176 @@ void NtpClient::end() {
   _udp.stop();
 }
 
+bool NtpClient::restore() {
+  // Power on and the reset pin clear the RTC tick counter, only resets that keep it running can be bridged
+  switch (ESP.getResetInfoPtr()->reason) {
+    case REASON_WDT_RST:
+    case REASON_EXCEPTION_RST:
+    case REASON_SOFT_WDT_RST:
+    case REASON_SOFT_RESTART:
+    case REASON_DEEP_SLEEP_AWAKE:
+      break;
+    default:
+      return false;
+  }
+
+  PersistedClock clock;
+  if (!ESP.rtcUserMemoryRead(NTP_RTC_BLOCK, reinterpret_cast<std::uint32_t*>(&clock), sizeof(clock))
+      || clock.magic != PERSISTED_CLOCK_MAGIC || clock.checksum != clock.calculateChecksum()) {
+    Logger::println("[NTP] No saved clock state to restore");
+    return false;
+  }
+
+  // The tick length moves with temperature, the calibrations from either side of the reset are averaged
+  std::uint32_t ticks       = system_get_rtc_time() - clock.rtcTicks;
+  std::uint64_t calibration = (static_cast<std::uint64_t>(clock.rtcCalibration) + system_rtc_clock_cali_proc()) / 2;
+  std::uint64_t gapMicros   = (ticks * calibration) >> 12;
+  if (gapMicros > NTP_MAX_RESTORE_GAP_SECONDS * 1'000'000ULL) {
+    Logger::printlnf("[NTP] Saved clock state is too old (%u s)", static_cast<std::uint32_t>(gapMicros / 1'000'000));
+    return false;
+  }
+
+  std::uint64_t uncertainty = clock.uncertaintyMicros + gapMicros * NTP_RTC_ERROR_PPB / 1'000'000'000;
+
+  _anchor            = {micros64(), clock.epochMicros + gapMicros};
+  _anchorUncertainty = uncertainty < UINT32_MAX ? static_cast<std::uint32_t>(uncertainty) : UINT32_MAX;
+  _syncEpochMicros   = clock.syncEpochMicros;
+  _driftPpb          = clock.driftPpb;
+  _synced            = true;
+  _restored          = true;
+
+  char date[24];
+  formatEpochMicros(_anchor.epochMicros, date);
+  Logger::printlnf("[NTP] %s UTC restored after reset, uncertainty %u ms, last sync %u s ago",
+                   date,
+                   _anchorUncertainty / 1000,
+                   static_cast<std::uint32_t>((_anchor.epochMicros - _syncEpochMicros) / 1'000'000));
+
+  save();
+
+  return true;
+}
+
 void NtpClient::update() {
-  std::uint64_t now = millis();
+  std::uint32_t now = millis();
 
-  if (now - _lastTransmit >= NTP_UPDATE_INTERVAL_SECONDS * 1000) {
-    sendNtpPacket();
-    _lastTransmit = now;
+  resolveServers(now);
+
+  if (_synced && static_cast<std::int32_t>(now - _nextSave) >= 0) {
+    save();
+  }
+
+  for (std::size_t i = 0; i < NTP_SERVER_COUNT; ++i) {
+    if (_servers[i].requestMicros != 0 && micros64() - _servers[i].requestMicros >= NTP_RESPONSE_TIMEOUT_MS * 1000ULL) {
+      fail(i, now, "no response");
+    }
   }
 
-  if (handleNtpPacket()) {
-    _lastReceive = now;
+  handleNtpPacket();
+
+  if (isPending()) {
+    return;
+  }
+
+  // A burst is over once every server has answered or timed out
+  if (_bursting) {
+    _bursting    = false;
+    _nextRequest = now + (isTimeValid() ? NTP_UPDATE_INTERVAL_SECONDS : NTP_BACKOFF_MIN_SECONDS) * 1000;
+  }
+
+  if (static_cast<std::int32_t>(now - _nextRequest) < 0) {
+    return;
+  }
+
+  // Without a valid time, ask everyone so the first reply sets the clock and faster ones refine it
+  if (!isTimeValid()) {
+    _burstRoundTrip = UINT32_MAX;
+    for (std::size_t i = 0; i < NTP_SERVER_COUNT; ++i) {
+      if (NTP_SERVERS[i].ipAddr.isSet() && static_cast<std::int32_t>(now - _servers[i].retryAt) >= 0) {
+        sendNtpPacket(i);
+        _bursting = true;
+      }
+    }
+    if (!_bursting) {
+      _nextRequest = now + NTP_BACKOFF_MIN_SECONDS * 1000;
+    }
+    return;
   }
+
+  std::size_t index = selectServer(now);
+  if (index == MAX_SERVERS) {
+    _nextRequest = now + NTP_BACKOFF_MIN_SECONDS * 1000;
+    return;
+  }
+
+  sendNtpPacket(index);
+  _nextRequest = now + NTP_UPDATE_INTERVAL_SECONDS * 1000;
 }
 
 bool NtpClient::isTimeValid() const {
-  return _lastReceive != 0 && millis() - _lastReceive < NTP_UPDATE_INTERVAL_SECONDS * 1000 * 2;
+  return _synced && toEpochMicros(micros64()) - _syncEpochMicros < NTP_MAX_SYNC_AGE_SECONDS * 1'000'000ULL
+      && getUncertaintyMicros() <= NTP_MAX_UNCERTAINTY_MS * 1000;
 }
 
 time_t NtpClient::getEpochTime() const {
-  return _epochTime;
+  return static_cast<time_t>(toEpochMicros(micros64()) / 1'000'000);
+}
+
+std::uint64_t NtpClient::getEpochMillis() const {
+  return toEpochMicros(micros64()) / 1000;
+}
+
+std::uint64_t NtpClient::toEpochMicros(std::uint64_t localMicros) const {
+  if (!_synced) {
+    return 0;
+  }
+
+  // The drift correction only ever spans the time since the last sync, well within 64 bits
+  std::int64_t elapsed = static_cast<std::int64_t>(localMicros - _anchor.localMicros);
+  return _anchor.epochMicros + elapsed + elapsed * _driftPpb / 1'000'000'000;
 }
 
-void NtpClient::sendNtpPacket() {
+std::uint32_t NtpClient::getUncertaintyMicros() const {
+  if (!_synced) {
+    return UINT32_MAX;
+  }
+
+  // Half the round trip at the sync, plus whatever the remaining rate error has added since
+  std::uint64_t elapsed     = micros64() - _anchor.localMicros;
+  std::uint64_t rateError   = _driftPpb != 0 ? NTP_DRIFT_ERROR_PPB : NTP_CRYSTAL_ERROR_PPB;
+  std::uint64_t uncertainty = _anchorUncertainty + elapsed * rateError / 1'000'000'000;
+  return uncertainty < UINT32_MAX ? static_cast<std::uint32_t>(uncertainty) : UINT32_MAX;
+}
+
+const char* NtpClient::getServerName(std::size_t index) const {
+  return index < NTP_SERVER_COUNT ? NTP_SERVERS[index].hostName : nullptr;
+}
+
+void NtpClient::sendNtpPacket(std::size_t index) {
   memset(_buffer, 0, NTP_PACKET_SIZE);
 
-  _buffer[0] = 0b11100011;  // LI, Version, Mode
+  _buffer[0] = 0b00100011;  // LI 0, version 4, mode 3 (client)
 
-  IPAddress ntpServerIP;
-  for (std::size_t i = 0; i < NTP_SERVER_COUNT; ++i) {
-    if (NTP_SERVERS[i].ipAddr.isSet()) {
-      ntpServerIP  = NTP_SERVERS[i].ipAddr;
-      _serverIndex = i;
-      break;
+  // The transmit timestamp is echoed back as the originate timestamp, the local send time identifies the reply.
+  // T1 is taken as late as possible, right before the packet is handed to the network stack
+  Server& server = _servers[index];
+  _udp.beginPacket(NTP_SERVERS[index].ipAddr, NTP_PORT);
+  std::uint64_t requestMicros = micros64();
+
+  // Requests of a burst can go out within the same microsecond, every pending one needs its own timestamp
+  bool unique = false;
+  while (!unique) {
+    unique = true;
+    for (const Server& other : _servers) {
+      if (other.requestMicros == requestMicros) {
+        requestMicros++;
+        unique = false;
+      }
     }
   }
 
-  _udp.beginPacket(ntpServerIP, NTP_PORT);
+  server.requestMicros = requestMicros;
+  WriteTimestamp(_buffer + 40, requestMicros);
   _udp.write(_buffer, NTP_PACKET_SIZE);
   _udp.endPacket();
 }
@@ -100,19 +310,272 @@ bool NtpClient::handleNtpPacket() {
     return false;
   }
 
+  // T4, before anything else is done with the packet
+  std::uint64_t receiveMicros = micros64();
+
   if (_udp.read(_buffer, NTP_PACKET_SIZE) != NTP_PACKET_SIZE) {
     Logger::println("[NTP] Received invalid NTP packet");
     return false;
   }
 
-  std::uint32_t NTPTime = ((std::uint32_t)_buffer[40] << 24) | ((std::uint32_t)_buffer[41] << 16)
-                        | ((std::uint32_t)_buffer[42] << 8) | ((std::uint32_t)_buffer[43] << 0);
+  // Replies to an earlier, timed out request or to someone else's request are not ours to use
+  std::uint64_t originate = ReadTimestamp(_buffer + 24);
+  std::size_t index       = 0;
+  while (index < NTP_SERVER_COUNT && (_servers[index].requestMicros == 0 || _servers[index].requestMicros != originate)) {
+    ++index;
+  }
+  if (index == NTP_SERVER_COUNT) {
+    Logger::println("[NTP] Received unexpected NTP packet");
+    return false;
+  }
+
+  Server& server              = _servers[index];
+  std::uint64_t requestMicros = server.requestMicros;
+  server.requestMicros        = 0;
 
-  constexpr std::uint32_t EPOCH = 2'208'988'800UL;
+  std::uint8_t leap    = _buffer[0] >> 6;
+  std::uint8_t mode    = _buffer[0] & 0x07;
+  std::uint8_t stratum = _buffer[1];
+  if (stratum == 0) {
+    // Kiss-o'-death, the reference ID carries an ASCII code such as RATE or DENY
+    char code[5] = {static_cast<char>(_buffer[12]),
+                    static_cast<char>(_buffer[13]),
+                    static_cast<char>(_buffer[14]),
+                    static_cast<char>(_buffer[15]),
+                    '\0'};
+    Logger::printlnf("[NTP] %s sent kiss code %s", NTP_SERVERS[index].hostName, code);
+    fail(index, millis(), "kiss-o'-death");
+    return false;
+  }
+  if (mode != 4 || leap == 3 || stratum > 15) {
+    fail(index, millis(), "unusable reply");
+    return false;
+  }
 
-  _epochTime = NTPTime - EPOCH;
+  std::uint64_t serverReceive  = ReadTimestamp(_buffer + 32);
+  std::uint64_t serverTransmit = ReadTimestamp(_buffer + 40);
+  if (serverReceive == 0 || serverTransmit == 0) {
+    fail(index, millis(), "reply is missing timestamps");
+    return false;
+  }
+
+  // T1..T4: the server's hold time is subtracted from the round trip, the reply took half of what remains
+  std::int64_t t2    = static_cast<std::int64_t>(TimestampToEpochMicros(serverReceive));
+  std::int64_t t3    = static_cast<std::int64_t>(TimestampToEpochMicros(serverTransmit));
+  std::int64_t delay = static_cast<std::int64_t>(receiveMicros - requestMicros) - (t3 - t2);
+  if (delay < 0) {
+    delay = 0;
+  }
+  if (delay > NTP_MAX_DELAY_MS * 1000LL) {
+    fail(index, millis(), "round trip too long");
+    return false;
+  }
+
+  ServerStats& stats    = server.stats;
+  stats.roundTripMicros = static_cast<std::uint32_t>(delay);
+  stats.stratum         = stratum;
+  stats.recentLosses    = stats.recentLosses / 2;
+  stats.failures        = 0;
+  stats.replies++;
+
+  // During a burst only a reply with a shorter round trip, and so a smaller possible error, replaces the clock
+  if (_bursting && stats.roundTripMicros >= _burstRoundTrip) {
+    return true;
+  }
+  if (_bursting) {
+    _burstRoundTrip = stats.roundTripMicros;
+  }
 
-  Logger::printlnf("[NTP] Received packet: %Y-%m-%d %H:%M:%S", localtime(&_epochTime));
+  _roundTripMicros = stats.roundTripMicros;
+  applySample({receiveMicros, static_cast<std::uint64_t>(t3 + delay / 2)}, index);
 
   return true;
 }
+
+void NtpClient::resolveServers(std::uint32_t now) {
+  for (std::size_t i = 0; i < NTP_SERVER_COUNT; ++i) {
+    NtpServerRecord& record = NTP_SERVERS[i];
+    switch (record.dnsState) {
+      case DnsState::Resolved:
+        record.dnsState = DnsState::Idle;
+        record.lookupAt = now + NTP_RESOLVE_INTERVAL_SECONDS * 1000;
+        if (record.lookupAddr != record.ipAddr) {
+          record.ipAddr = record.lookupAddr;
+          Logger::printlnf("[NTP] %s is %s", record.hostName, record.ipAddr.toString().c_str());
+        }
+        // Without a valid time there's no reason to wait for the next burst
+        if (!isTimeValid() && !_bursting) {
+          _nextRequest = now;
+        }
+        break;
+      case DnsState::Failed:
+        // A known address is kept until a lookup replaces it
+        record.dnsState = DnsState::Idle;
+        record.lookupAt = now + NTP_RESOLVE_RETRY_SECONDS * 1000;
+        Logger::printlnf("[NTP] Unable to resolve %s", record.hostName);
+        break;
+      default:
+        break;
+    }
+
+    if (record.dnsState == DnsState::Idle && static_cast<std::int32_t>(now - record.lookupAt) >= 0) {
+      startLookup(i, now);
+    }
+  }
+}
+
+void NtpClient::startLookup(std::size_t index, std::uint32_t now) {
+  NtpServerRecord& record = NTP_SERVERS[index];
+
+  // lwIP answers from its own cache while the record's TTL lasts, only expired names go to the network
+  ip_addr_t address;
+  err_t err = dns_gethostbyname(record.hostName, &address, handleDnsFound, reinterpret_cast<void*>(index));
+  if (err == ERR_OK) {
+    record.ipAddr   = IPAddress(&address);
+    record.lookupAt = now + NTP_RESOLVE_INTERVAL_SECONDS * 1000;
+  } else if (err == ERR_INPROGRESS) {
+    record.dnsState = DnsState::Pending;
+  } else {
+    record.lookupAt = now + NTP_RESOLVE_RETRY_SECONDS * 1000;
+    Logger::printlnf("[NTP] Unable to look up %s (error %d)", record.hostName, err);
+  }
+}
+
+bool NtpClient::isPending() const {
+  for (const Server& server : _servers) {
+    if (server.requestMicros != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t NtpClient::selectServer(std::uint32_t now) {
+  bool probe = ++_requests % NTP_PROBE_EVERY == 0;
+
+  std::size_t best = MAX_SERVERS;
+  for (std::size_t n = 1; n <= NTP_SERVER_COUNT; ++n) {
+    std::size_t i = (_probeIndex + n) % NTP_SERVER_COUNT;
+    if (!NTP_SERVERS[i].ipAddr.isSet() || static_cast<std::int32_t>(now - _servers[i].retryAt) < 0) {
+      continue;
+    }
+    if (probe) {
+      _probeIndex = i;
+      return i;
+    }
+    if (best == MAX_SERVERS || score(i) < score(best)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+std::uint32_t NtpClient::score(std::size_t index) const {
+  const ServerStats& stats = _servers[index].stats;
+
+  // A server that never answered ranks behind every one that did, but is still tried when they fail
+  std::uint32_t roundTrip = stats.replies > 0 ? stats.roundTripMicros : NTP_MAX_DELAY_MS * 1000;
+  std::uint32_t stratum   = stats.stratum > 1 ? stats.stratum - 1 : 0;
+  return roundTrip + stratum * NTP_STRATUM_PENALTY_US + stats.recentLosses * NTP_LOSS_PENALTY_US;
+}
+
+void NtpClient::fail(std::size_t index, std::uint32_t now, const char* reason) {
+  Server& server       = _servers[index];
+  ServerStats& stats   = server.stats;
+  server.requestMicros = 0;
+
+  stats.losses++;
+  stats.recentLosses = stats.recentLosses < UINT8_MAX ? stats.recentLosses + 1 : UINT8_MAX;
+  stats.failures     = stats.failures < 16 ? stats.failures + 1 : 16;
+
+  std::uint32_t backoff = NTP_BACKOFF_MIN_SECONDS << (stats.failures - 1);
+  backoff               = backoff < NTP_BACKOFF_MAX_SECONDS ? backoff : NTP_BACKOFF_MAX_SECONDS;
+  server.retryAt        = now + backoff * 1000;
+
+  Logger::printlnf("[NTP] %s: %s, skipped for %u s", NTP_SERVERS[index].hostName, reason, backoff);
+
+  // Fail over to the next best server right away instead of waiting out the interval
+  if (!_bursting) {
+    _nextRequest = now;
+  }
+}
+
+void NtpClient::applySample(const Anchor& sample, std::size_t index) {
+  // How far the mapping was off, the SNTP clock offset. After a restore this is the error of the restored time
+  std::int64_t offset = _synced ? static_cast<std::int64_t>(sample.epochMicros - toEpochMicros(sample.localMicros)) : 0;
+
+  if (!_synced || _restored) {
+    // A restored drift rate is kept, but its baseline ended with the reset
+    _driftReference = sample;
+  } else if (sample.localMicros - _driftReference.localMicros >= NTP_DRIFT_INTERVAL_SECONDS * 1'000'000ULL) {
+    // Rate error over the baseline, smoothed since every end point carries up to half a round trip of error
+    std::int64_t local    = static_cast<std::int64_t>(sample.localMicros - _driftReference.localMicros);
+    std::int64_t epoch    = static_cast<std::int64_t>(sample.epochMicros - _driftReference.epochMicros);
+    std::int64_t measured = (epoch - local) * 1'000'000'000 / local;
+    if (measured > -NTP_MAX_DRIFT_PPB && measured < NTP_MAX_DRIFT_PPB) {
+      _driftPpb = _driftPpb == 0 ? static_cast<std::int32_t>(measured)
+                                 : static_cast<std::int32_t>((_driftPpb * 3LL + measured) / 4);
+    }
+    _driftReference = sample;
+  }
+
+  _anchor            = sample;
+  _anchorUncertainty = _roundTripMicros / 2;
+  _syncEpochMicros   = sample.epochMicros;
+  _synced            = true;
+  _restored          = false;
+
+  save();
+
+  char date[24];
+  formatEpochMicros(sample.epochMicros, date);
+  Logger::printlnf("[NTP] %s UTC from %s, offset %d ms, round trip %u ms, drift %d ppm",
+                   date,
+                   NTP_SERVERS[index].hostName,
+                   static_cast<std::int32_t>(offset / 1000),
+                   _roundTripMicros / 1000,
+                   _driftPpb / 1000);
+}
+
+void NtpClient::save() {
+  PersistedClock clock;
+  clock.magic             = PERSISTED_CLOCK_MAGIC;
+  clock.rtcTicks          = system_get_rtc_time();
+  clock.rtcCalibration    = system_rtc_clock_cali_proc();
+  clock.epochMicros       = toEpochMicros(micros64());
+  clock.syncEpochMicros   = _syncEpochMicros;
+  clock.uncertaintyMicros = getUncertaintyMicros();
+  clock.driftPpb          = _driftPpb;
+  clock.checksum          = clock.calculateChecksum();
+
+  if (!ESP.rtcUserMemoryWrite(NTP_RTC_BLOCK, reinterpret_cast<std::uint32_t*>(&clock), sizeof(clock))) {
+    Logger::println("[NTP] Unable to save clock state");
+  }
+
+  _nextSave = millis() + NTP_SAVE_INTERVAL_MS;
+}
+
+std::uint64_t NtpClient::ReadTimestamp(const std::uint8_t* data) {
+  std::uint64_t timestamp = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    timestamp = (timestamp << 8) | data[i];
+  }
+  return timestamp;
+}
+
+void NtpClient::WriteTimestamp(std::uint8_t* data, std::uint64_t timestamp) {
+  for (std::size_t i = 8; i-- > 0;) {
+    data[i] = static_cast<std::uint8_t>(timestamp);
+    timestamp >>= 8;
+  }
+}
+
+std::uint64_t NtpClient::TimestampToEpochMicros(std::uint64_t timestamp) {
+  // Seconds wrap in 2036, values below 1970 belong to the next era
+  std::uint64_t seconds  = timestamp >> 32;
+  std::uint64_t fraction = timestamp & 0xFFFF'FFFF;
+  if (seconds < NTP_UNIX_EPOCH_OFFSET) {
+    seconds += 1ULL << 32;
+  }
+  return (seconds - NTP_UNIX_EPOCH_OFFSET) * 1'000'000 + ((fraction * 1'000'000) >> 32);
+}
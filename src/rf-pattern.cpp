@@ -0,0 +1,128 @@
+#include "rf-pattern.hpp"
+
+RfPattern::RfPattern()
+  : _segments(), _frames(), _keyframeCount(0), _frameCount(0), _periodMs(0), _transmitterId(0), _channel(), _loops(0) { }
+
+bool RfPattern::compile(std::uint16_t transmitterId,
+                        Channel channel,
+                        const CollarKeyframe* keyframes,
+                        std::size_t count,
+                        std::uint8_t loops) {
+  clear();
+
+  if (count == 0 || count > MAX_KEYFRAMES || keyframes[0].shape == KeyframeShape::Pause) {
+    return false;
+  }
+
+  std::uint8_t strength = 0;  // Where the next ramp starts
+  std::uint32_t startMs = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const CollarKeyframe& keyframe = keyframes[i];
+    if (keyframe.durationMs == 0 || keyframe.shape < KeyframeShape::_Min || keyframe.shape > KeyframeShape::_Max) {
+      clear();
+      return false;
+    }
+
+    Segment& segment   = _segments[i];
+    segment.startMs    = startMs;
+    segment.durationMs = keyframe.durationMs;
+    segment.firstFrame = static_cast<std::uint8_t>(_frameCount);
+    segment.frameCount = 0;
+
+    startMs += keyframe.durationMs;
+
+    if (keyframe.shape == KeyframeShape::Pause) {
+      continue;
+    }
+
+    // Ramp frames are patched from the first one, so the end strength is never checked by the encoder
+    if (keyframe.strength > Protocol::MAX_STRENGTH) {
+      clear();
+      return false;
+    }
+
+    // A ramp ends on the keyframe's strength, its first step is already one past the previous strength
+    std::int32_t from  = keyframe.shape == KeyframeShape::Ramp ? strength : keyframe.strength;
+    std::int32_t delta = keyframe.strength - from;
+    std::size_t steps  = delta < 0 ? -delta : delta;
+    std::size_t slots  = keyframe.durationMs / FRAME_MS;
+    std::size_t frames = steps < slots ? steps : slots;
+    frames             = frames > 0 ? frames : 1;
+    if (_frameCount + frames > MAX_FRAMES) {
+      clear();
+      return false;
+    }
+
+    CollarFrameFields fields {transmitterId, channel, keyframe.command, keyframe.strength};
+    for (std::size_t k = 0; k < frames; ++k) {
+      std::int32_t step = static_cast<std::int32_t>(k + 1);
+      fields.strength   = static_cast<std::uint8_t>(from + delta * step / static_cast<std::int32_t>(frames));
+
+      Frame& frame = _frames[_frameCount + k];
+      if (k == 0) {
+        if (!Protocol::Encode(fields, frame)) {
+          clear();
+          return false;
+        }
+      } else {
+        // Only the strength dependent symbols change along the ramp
+        frame = _frames[_frameCount];
+        Protocol::PatchStrength(frame, fields);
+      }
+    }
+
+    segment.frameCount = static_cast<std::uint8_t>(frames);
+    _frameCount        = _frameCount + frames;
+    strength           = keyframe.strength;
+  }
+
+  // A pass is at most MAX_KEYFRAMES * 65535 ms, times 255 loops still fits
+  if (loops != 0 && startMs * loops > MAX_DURATION_MS) {
+    clear();
+    return false;
+  }
+
+  _keyframeCount = count;
+  _periodMs      = startMs;
+  _transmitterId = transmitterId;
+  _channel       = channel;
+  _loops         = loops;
+
+  return true;
+}
+
+void RfPattern::clear() {
+  _keyframeCount = 0;
+  _frameCount    = 0;
+  _periodMs      = 0;
+  _loops         = 0;
+}
+
+std::size_t RfPattern::keyframeAt(std::uint32_t elapsedMs) const {
+  if (empty() || finished(elapsedMs)) {
+    return MAX_KEYFRAMES;
+  }
+
+  std::uint32_t offset = elapsedMs % _periodMs;
+
+  std::size_t index = 0;
+  while (index + 1 < _keyframeCount && offset >= _segments[index + 1].startMs) {
+    ++index;
+  }
+  return index;
+}
+
+const RfPattern::Frame* RfPattern::frameAt(std::uint32_t elapsedMs) const {
+  std::size_t index = keyframeAt(elapsedMs);
+  if (index == MAX_KEYFRAMES) {
+    return nullptr;
+  }
+
+  const Segment& segment = _segments[index];
+  if (segment.frameCount == 0) {
+    return nullptr;
+  }
+
+  std::uint32_t offset = elapsedMs % _periodMs - segment.startMs;
+  return &_frames[segment.firstFrame + offset * segment.frameCount / segment.durationMs];
+}
@@ -0,0 +1,35 @@
+#include "rf-pulse-train.hpp"
+
+RfPulseTrain::RfPulseTrain() : _durations(), _count(0), _totalUs(0) { }
+
+bool RfPulseTrain::build(const std::byte* frame, std::size_t length, std::uint16_t chipUs) {
+  _count   = 0;
+  _totalUs = 0;
+
+  if (length == 0 || length > MAX_FRAME_SIZE || (static_cast<std::uint8_t>(frame[0]) & 0x80) == 0) {
+    return false;
+  }
+
+  bool level        = true;
+  std::uint16_t run  = 0;
+  for (std::size_t i = 0; i < length; ++i) {
+    std::uint8_t symbols = static_cast<std::uint8_t>(frame[i]);
+    for (int bit = 7; bit >= 0; --bit) {
+      bool chip = ((symbols >> bit) & 1) != 0;
+      if (chip != level) {
+        _durations[_count++] = run * chipUs;
+        _totalUs += run * chipUs;
+        level = chip;
+        run   = 0;
+      }
+      run++;
+    }
+  }
+  _durations[_count++] = run * chipUs;
+  _totalUs += run * chipUs;
+
+  return true;
+}
+
+RfPulsePlayer::RfPulsePlayer()
+  : _train(nullptr), _index(0), _remaining(0), _gapUs(0), _gapPending(false), _active(false) { }
@@ -0,0 +1,226 @@
+#include "rf-scheduler.hpp"
+
+RfScheduler::RfScheduler(std::uint32_t frameMs)
+  : _targets()
+  , _cursor(0)
+  , _radio {MAX_TARGETS, MAX_TARGETS, 0}
+  , _radioBeforeNext(_radio)
+  , _startedByNext(false)
+  , _frameMs(frameMs)
+  , _stats() { }
+
+bool RfScheduler::submit(const CollarCommand& command, std::uint32_t now, std::uint32_t deadlineMs) {
+  // Encoded right into the target, a failed encode leaves the frame of a command it would replace untouched
+  Target* target = _claim(command.transmitterId, command.channel);
+  if (target == nullptr
+      || !Protocol::Encode({command.transmitterId, command.channel, command.command, command.strength}, target->frame)) {
+    _stats.rejected++;
+    return false;
+  }
+
+  if (target->active) {
+    _stats.replaced++;
+  }
+
+  target->active        = true;
+  target->started       = false;
+  target->transmitterId = command.transmitterId;
+  target->channel       = command.channel;
+  target->deadline      = now + deadlineMs;
+  target->durationMs    = command.durationMs;
+  target->startTime     = 0;
+  target->endTime       = 0;
+  target->pattern       = nullptr;
+
+  _stats.submitted++;
+
+  return true;
+}
+
+bool RfScheduler::submit(const RfPattern& pattern, std::uint32_t now, std::uint32_t deadlineMs) {
+  Target* target = _claim(pattern.transmitterId(), pattern.channel());
+  if (target == nullptr || pattern.empty()) {
+    _stats.rejected++;
+    return false;
+  }
+
+  if (target->active) {
+    _stats.replaced++;
+  }
+
+  target->active        = true;
+  target->started       = false;
+  target->transmitterId = pattern.transmitterId();
+  target->channel       = pattern.channel();
+  target->deadline      = now + deadlineMs;
+  target->durationMs    = 0;
+  target->startTime     = 0;
+  target->endTime       = 0;
+  target->pattern       = &pattern;
+
+  _stats.submitted++;
+
+  return true;
+}
+
+bool RfScheduler::stop(std::uint16_t transmitterId, Channel channel, std::uint32_t now) {
+  Target* target = _find(transmitterId, channel);
+  return target != nullptr && _cancel(*target, now);
+}
+
+bool RfScheduler::stop(const RfPattern& pattern, std::uint32_t now) {
+  Target* target = _find(pattern.transmitterId(), pattern.channel());
+  return target != nullptr && target->pattern == &pattern && _cancel(*target, now);
+}
+
+bool RfScheduler::scheduled(const RfPattern& pattern) const {
+  for (const Target& target : _targets) {
+    if (target.active && target.pattern == &pattern) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const RfScheduler::Frame* RfScheduler::next(std::uint32_t now) {
+  if (_before(now + _frameMs, _radio.busyUntil)) {
+    return nullptr;
+  }
+
+  // The frame starts right away on an idle radio, otherwise once the frame on air has ended
+  std::uint32_t start = now;
+  if (_before(now, _radio.busyUntil)) {
+    start = _radio.busyUntil;
+  } else {
+    _radio.last     = MAX_TARGETS;
+    _radio.previous = MAX_TARGETS;
+  }
+
+  _retire(start);
+
+  // Earliest deadline among commands still waiting for their first frame
+  std::size_t chosen = MAX_TARGETS;
+  for (std::size_t i = 0; i < MAX_TARGETS; ++i) {
+    const Target& target = _targets[i];
+    if (target.active && !target.started && (chosen == MAX_TARGETS || _before(target.deadline, _targets[chosen].deadline))) {
+      chosen = i;
+    }
+  }
+
+  // Otherwise the next running target after the last one served, a pattern in a pause has nothing to send
+  for (std::size_t i = 1; chosen == MAX_TARGETS && i <= MAX_TARGETS; ++i) {
+    std::size_t index = (_cursor + i) % MAX_TARGETS;
+    if (_targets[index].active && _frameOf(_targets[index], start) != nullptr) {
+      chosen = index;
+    }
+  }
+
+  if (chosen == MAX_TARGETS) {
+    return nullptr;
+  }
+
+  Target& target   = _targets[chosen];
+  _radioBeforeNext = _radio;
+  _startedByNext   = !target.started;
+  if (!target.started) {
+    target.started   = true;
+    target.startTime = start;
+    target.endTime   = start + target.durationMs;
+  }
+
+  _cursor          = chosen;
+  _radio.previous  = _radio.last;
+  _radio.last      = chosen;
+  _radio.busyUntil = start + _frameMs;
+  _stats.framesSent++;
+
+  return _frameOf(target, start);
+}
+
+void RfScheduler::unsend() {
+  if (_radio.last == MAX_TARGETS) {
+    return;
+  }
+
+  if (_startedByNext) {
+    _targets[_radio.last].started = false;
+  }
+
+  _radio         = _radioBeforeNext;
+  _startedByNext = false;
+  _stats.framesSent--;
+  _stats.framesFailed++;
+}
+
+std::size_t RfScheduler::activeTargets() const {
+  std::size_t count = 0;
+  for (const Target& target : _targets) {
+    count += target.active ? 1 : 0;
+  }
+  return count;
+}
+
+RfScheduler::Target* RfScheduler::_find(std::uint16_t transmitterId, Channel channel) {
+  for (Target& target : _targets) {
+    if (target.active && target.transmitterId == transmitterId && target.channel == channel) {
+      return &target;
+    }
+  }
+  return nullptr;
+}
+
+RfScheduler::Target* RfScheduler::_claim(std::uint16_t transmitterId, Channel channel) {
+  Target* target = _find(transmitterId, channel);
+  for (std::size_t i = 0; target == nullptr && i < MAX_TARGETS; ++i) {
+    if (!_targets[i].active) {
+      target = &_targets[i];
+    }
+  }
+  return target;
+}
+
+const RfScheduler::Frame* RfScheduler::_frameOf(const Target& target, std::uint32_t now) const {
+  if (target.pattern == nullptr) {
+    return &target.frame;
+  }
+
+  // A pattern never starts with a pause, so a target waiting for its first frame always has one
+  return target.pattern->frameAt(target.started ? now - target.startTime : 0);
+}
+
+bool RfScheduler::_cancel(Target& target, std::uint32_t now) {
+  target.active = false;
+  _stats.stopped++;
+
+  std::size_t index = &target - _targets;
+  bool last         = _radio.last == index && _before(now, _radio.busyUntil);
+  bool previous     = _radio.previous == index && _before(now, _radio.busyUntil - _frameMs);
+  if (!last && !previous) {
+    return false;
+  }
+
+  // The caller stops the radio, which also drops a frame of another collar waiting behind this one
+  _radio = {MAX_TARGETS, MAX_TARGETS, now};
+  _stats.preempted++;
+
+  return true;
+}
+
+void RfScheduler::_retire(std::uint32_t now) {
+  for (Target& target : _targets) {
+    if (!target.active) {
+      continue;
+    }
+
+    // Every command gets at least one frame, so a started command ends only after it has been on air once
+    bool finished = target.pattern != nullptr ? target.pattern->finished(now - target.startTime)
+                                              : !_before(now, target.endTime);
+    if (target.started && finished) {
+      target.active = false;
+      _stats.completed++;
+    } else if (!target.started && _before(target.deadline, now)) {
+      target.active = false;
+      _stats.expired++;
+    }
+  }
+}
@@ -0,0 +1,143 @@
+#include "rf-transmitter.hpp"
+
+#include "logger.hpp"
+#include "rf-pulse-train.hpp"
+
+#include <Arduino.h>
+
+// One train plays while the other is built, the interrupt switches to the pending one when the playing one ends
+RfPulseTrain s_rfTrains[2];
+const RfPulseTrain* s_rfPlaying          = &s_rfTrains[0];
+const RfPulseTrain* volatile s_rfPending = nullptr;
+RfPulsePlayer s_rfPlayer;
+std::uint32_t s_rfPinMask = 0;
+
+std::uint32_t IRAM_ATTR rfTicksFor(std::uint32_t durationUs) {
+  std::uint32_t ticks = durationUs * RfTransmitter::TIMER_TICKS_PER_US;
+  if (ticks <= RfTransmitter::TIMER_LATENCY_TICKS) {
+    return 1;
+  }
+  ticks -= RfTransmitter::TIMER_LATENCY_TICKS;
+  return ticks < RfTransmitter::TIMER_MAX_TICKS ? ticks : RfTransmitter::TIMER_MAX_TICKS;
+}
+
+// The timer is re-armed before the pin is touched so interrupt latency doesn't add to the next pulse
+void IRAM_ATTR handleRfTimer() {
+  bool level;
+  std::uint32_t duration = s_rfPlayer.next(level);
+  if (duration == 0 && s_rfPending != nullptr) {
+    s_rfPlaying = s_rfPending;
+    s_rfPending = nullptr;
+    s_rfPlayer.begin(*s_rfPlaying, 1, 0);
+    duration = s_rfPlayer.next(level);
+  }
+  if (duration == 0) {
+    GPOC = s_rfPinMask;
+    timer1_disable();
+    return;
+  }
+
+  timer1_write(rfTicksFor(duration));
+  if (level) {
+    GPOS = s_rfPinMask;
+  } else {
+    GPOC = s_rfPinMask;
+  }
+}
+
+bool RfTransmitter::Begin(std::uint8_t pin) {
+  if (pin > 15) {
+    Logger::printlnf("[RfTransmitter] GPIO %u can't be driven from the timer interrupt", pin);
+    return false;
+  }
+
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+  s_rfPinMask = 1UL << pin;
+
+  timer1_isr_init();
+  timer1_attachInterrupt(handleRfTimer);
+
+  return true;
+}
+
+void RfTransmitter::End() {
+  Stop();
+  timer1_detachInterrupt();
+  s_rfPinMask = 0;
+}
+
+// Starts playing the train from loop(), the interrupt must not be running
+bool rfStart(const RfPulseTrain& train, std::uint16_t repeats, std::uint32_t gapUs) {
+  s_rfPlaying = &train;
+  s_rfPlayer.begin(train, repeats, gapUs);
+
+  bool level;
+  std::uint32_t duration = s_rfPlayer.next(level);
+  if (duration == 0) {
+    return false;
+  }
+
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+  timer1_write(rfTicksFor(duration));
+  GPOS = s_rfPinMask;
+
+  return true;
+}
+
+bool RfTransmitter::Transmit(const std::byte* frame,
+                             std::size_t length,
+                             std::uint16_t chipUs,
+                             std::uint16_t repeats,
+                             std::uint32_t gapUs) {
+  if (s_rfPinMask == 0) {
+    return false;
+  }
+
+  // The interrupt reads the pulse train, it has to be stopped before the train is rebuilt
+  Stop();
+
+  if (!s_rfTrains[0].build(frame, length, chipUs)) {
+    Logger::println("[RfTransmitter] Invalid frame");
+    return false;
+  }
+
+  return rfStart(s_rfTrains[0], repeats, gapUs);
+}
+
+bool RfTransmitter::Queue(const std::byte* frame, std::size_t length, std::uint16_t chipUs) {
+  if (!CanQueue()) {
+    return false;
+  }
+
+  // The interrupt only reads the playing train while nothing is pending
+  RfPulseTrain& train = s_rfPlaying == &s_rfTrains[0] ? s_rfTrains[1] : s_rfTrains[0];
+  if (!train.build(frame, length, chipUs)) {
+    Logger::println("[RfTransmitter] Invalid frame");
+    return false;
+  }
+
+  noInterrupts();
+  bool playing = s_rfPlayer.active();
+  if (playing) {
+    s_rfPending = &train;
+  }
+  interrupts();
+
+  return playing || rfStart(train, 1, 0);
+}
+
+bool RfTransmitter::CanQueue() {
+  return s_rfPinMask != 0 && s_rfPending == nullptr;
+}
+
+void RfTransmitter::Stop() {
+  timer1_disable();
+  s_rfPending = nullptr;
+  s_rfPlayer.stop();
+  GPOC = s_rfPinMask;
+}
+
+bool RfTransmitter::IsBusy() {
+  return s_rfPlayer.active();
+}
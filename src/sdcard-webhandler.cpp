@@ -1,45 +1,37 @@
 #include "sdcard-webhandler.hpp"
 
 #include "logger.hpp"
+#include "mime-types.hpp"
 #include "sdcard.hpp"
 
-const char* GetMime(const char* extension) {
-  if (strcmp(extension, ".html") == 0) {
-    return "text/html";
-  } else if (strcmp(extension, ".css") == 0) {
-    return "text/css";
-  } else if (strcmp(extension, ".js") == 0) {
-    return "application/javascript";
-  } else if (strcmp(extension, ".png") == 0) {
-    return "image/png";
-  } else if (strcmp(extension, ".jpg") == 0) {
-    return "image/jpeg";
-  } else if (strcmp(extension, ".ico") == 0) {
-    return "image/x-icon";
-  } else if (strcmp(extension, ".svg") == 0) {
-    return "image/svg+xml";
-  } else if (strcmp(extension, ".ttf") == 0) {
-    return "font/ttf";
-  } else if (strcmp(extension, ".woff") == 0) {
-    return "font/woff";
-  } else if (strcmp(extension, ".woff2") == 0) {
-    return "font/woff2";
-  } else if (strcmp(extension, ".otf") == 0) {
-    return "font/otf";
-  } else if (strcmp(extension, ".txt") == 0) {
-    return "text/plain";
-  } else if (strcmp(extension, ".json") == 0) {
-    return "application/json";
-  } else if (strcmp(extension, ".pdf") == 0) {
-    return "application/pdf";
-  }
-
-  Logger::printlnf("Unknown file extension: %s", extension);
-
-  return "application/octet-stream";
+constexpr std::size_t STREAM_LOG_THRESHOLD_BYTES = 64 * 1024;
+
+SDCardWebHandler::SDCardWebHandler()
+  : _sd(), _cache(), _transfers(), _streamBuffer(), _streamChunkSize(0), _streamStats() {
+  setStreamChunkSize(SD_STREAM_CHUNK_SIZE);
+
+  if (_sd.ok()) {
+    _cache.loadManifest(_sd);
+  }
 }
 
-SDCardWebHandler::SDCardWebHandler() : _sd() { }
+bool SDCardWebHandler::setStreamChunkSize(std::size_t size) {
+  size = std::max(STREAM_CHUNK_SIZE_MIN, std::min(size, STREAM_CHUNK_SIZE_MAX)) & ~(SD_SECTOR_SIZE - 1);
+  if (size == _streamChunkSize) {
+    return true;
+  }
+
+  std::unique_ptr<std::uint8_t[]> buffer(new (std::nothrow) std::uint8_t[size]);
+  if (!buffer) {
+    Logger::printlnf("[SDCardWebHandler] Unable to allocate %u byte stream buffer", size);
+    return false;
+  }
+
+  _streamBuffer    = std::move(buffer);
+  _streamChunkSize = size;
+
+  return true;
+}
 
 bool SDCardWebHandler::canHandle(HTTPMethod method, const String& uri) {
   return method == HTTP_GET && uri != "/ws" && _sd.ok();
@@ -65,19 +57,147 @@ bool SDCardWebHandler::handle(WebServerType& server, HTTPMethod requestMethod, c
     } else {
       strcpy(cPath, "/www");
       strcpy(cPath + 4, requestUri.c_str());
-      contentType = GetMime(requestUri.c_str() + lastDot);
+      contentType = MimeTypes::Get(requestUri.c_str() + lastDot);
+    }
+  }
+
+  // Cached assets are served from RAM, the SD card is only opened on a miss
+  bool rangeRequested             = server.hasHeader("Range");
+  const AssetCache::Entry* cached = _cache.find(cPath, _sd);
+
+  SDCardFile file;
+  if (cached == nullptr) {
+    file = _sd.open(cPath, O_READ);
+    if (!file) {
+      server.send(404, "text/plain", "File not found");
+      return true;
+    }
+
+    if (!rangeRequested) {
+      cached = _cache.insert(cPath, contentType, file);
     }
   }
 
-  auto file = _sd.open(cPath, O_READ);
-  if (!file) {
-    server.send(404, "text/plain", "File not found");
+  std::size_t size = cached != nullptr ? cached->size : file.size();
+
+  HttpRangeSet ranges;
+  switch (ranges.parse(server.header("Range").c_str(), size)) {
+    case HttpRangeSet::ParseResult::Satisfiable:
+      break;
+    case HttpRangeSet::ParseResult::Unsatisfiable:
+      {
+        char contentRange[32];
+        snprintf(contentRange, sizeof(contentRange), "bytes */%u", size);
+        server.sendHeader("Content-Range", contentRange);
+        server.send(416, "text/plain", "Range not satisfiable");
+      }
+      return true;
+    case HttpRangeSet::ParseResult::None:
+    default:
+      ranges = HttpRangeSet();
+      break;
+  }
+
+  HttpTransfer* transfer = _acquireTransfer();
+  if (transfer == nullptr) {
+    server.send(503, "text/plain", "Server busy");
     return true;
   }
 
+  // The body is streamed from update() after the web server has moved on, so the connection can't be reused
+  server.keepAlive(false);
   server.sendHeader("Cache-Control", "max-age=86400");
+  server.sendHeader("Accept-Ranges", "bytes");
+
+  if (ranges.count() == 1) {
+    char contentRange[48];
+    snprintf(contentRange, sizeof(contentRange), "bytes %u-%u/%u", ranges[0].start, ranges[0].last(), size);
+    server.sendHeader("Content-Range", contentRange);
+    server.setContentLength(ranges[0].length);
+    server.send(206, contentType, "");
+  } else if (ranges.count() > 1) {
+    server.setContentLength(HttpTransfer::MultipartLength(contentType, size, ranges));
+    server.send(206, HttpTransfer::MULTIPART_TYPE, "");
+  } else {
+    server.setContentLength(size);
+    server.send(200, contentType, "");
+  }
+
+  if (cached != nullptr) {
+    _cache.retain(*cached);
+    transfer->begin(server.client(), *cached, ranges);
+  } else {
+    transfer->begin(server.client(), std::move(file), contentType, ranges);
+  }
 
-  server.send(200, contentType, file.GetStream(), file.size());
+  _streamStats.activeTransfers++;
+  _streamStats.peakTransfers = std::max(_streamStats.peakTransfers, _streamStats.activeTransfers);
 
   return true;
 }
+
+bool SDCardWebHandler::busy() const {
+  for (const HttpTransfer& transfer : _transfers) {
+    if (transfer.idle()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SDCardWebHandler::update() {
+  for (HttpTransfer& transfer : _transfers) {
+    if (transfer.idle()) {
+      continue;
+    }
+
+    if (!transfer.pump(_streamBuffer.get(), _streamChunkSize)) {
+      _finishTransfer(transfer);
+    }
+  }
+}
+
+HttpTransfer* SDCardWebHandler::_acquireTransfer() {
+  if (!_streamBuffer) {
+    return nullptr;
+  }
+
+  for (HttpTransfer& transfer : _transfers) {
+    if (transfer.idle()) {
+      return &transfer;
+    }
+  }
+
+  return nullptr;
+}
+
+void SDCardWebHandler::_finishTransfer(HttpTransfer& transfer) {
+  std::uint32_t totalMicros = micros() - transfer.startMicros();
+  std::size_t sent          = transfer.bytesSent();
+
+  _streamStats.transfers++;
+  if (transfer.state() == HttpTransfer::State::Failed) {
+    _streamStats.failedTransfers++;
+  }
+  _streamStats.bytesSent += sent;
+  _streamStats.busyMicros += transfer.busyMicros();
+  _streamStats.totalMicros += totalMicros;
+  _streamStats.maxChunkMicros    = std::max(_streamStats.maxChunkMicros, transfer.maxStepMicros());
+  _streamStats.maxTransferMicros = std::max(_streamStats.maxTransferMicros, totalMicros);
+  _streamStats.activeTransfers--;
+
+  if (sent >= STREAM_LOG_THRESHOLD_BYTES && totalMicros > 0) {
+    Logger::printlnf("[SDCardWebHandler] Streamed %u bytes in %u ms: %u KB/s, %u us stall per MB (chunk %u, %u active)",
+                     sent,
+                     totalMicros / 1000,
+                     static_cast<std::uint32_t>((static_cast<std::uint64_t>(sent) * 1'000'000 / totalMicros) / 1024),
+                     static_cast<std::uint32_t>(static_cast<std::uint64_t>(transfer.busyMicros()) * 1024 * 1024 / sent),
+                     _streamChunkSize,
+                     _streamStats.activeTransfers);
+  }
+
+  if (transfer.cacheEntry() != nullptr) {
+    _cache.release(*transfer.cacheEntry());
+  }
+  transfer.reset();
+}
@@ -0,0 +1,54 @@
+#include "serializers/caixianlin-deserialize.hpp"
+
+constexpr std::size_t CAIXIANLIN_FRAME_CHIPS  = CAIXIANLIN_FRAME_SIZE * 8;
+constexpr std::uint32_t CAIXIANLIN_SYNC_CHIPS = 6;
+
+CaiXianlinParseResult ParseCaiXianlinPulses(const std::uint16_t* durationsUs,
+                                            std::size_t count,
+                                            CaiXianlinMessage& message,
+                                            std::uint16_t chipUs,
+                                            std::uint8_t tolerancePercent) {
+  if (count == 0) {
+    return CaiXianlinParseResult::BadTiming;
+  }
+
+  if (chipUs == 0) {
+    chipUs = (durationsUs[0] + CAIXIANLIN_SYNC_CHIPS / 2) / CAIXIANLIN_SYNC_CHIPS;
+    if (chipUs == 0) {
+      return CaiXianlinParseResult::BadTiming;
+    }
+  }
+  std::uint32_t toleranceUs = static_cast<std::uint32_t>(chipUs) * tolerancePercent / 100;
+
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame {};
+  std::size_t chip = 0;
+  for (std::size_t i = 0; i < count && chip < CAIXIANLIN_FRAME_CHIPS; ++i) {
+    std::uint32_t duration = durationsUs[i];
+    std::uint32_t chips    = (duration + chipUs / 2) / chipUs;
+    std::uint32_t ideal    = chips * chipUs;
+    std::uint32_t error    = duration > ideal ? duration - ideal : ideal - duration;
+
+    bool last = chip + chips >= CAIXIANLIN_FRAME_CHIPS;
+    if (chips == 0 || (error > toleranceUs && !last)) {
+      return CaiXianlinParseResult::BadTiming;
+    }
+
+    // Carrier-off chips are already zero
+    bool level = (i & 1) == 0;
+    for (std::uint32_t c = 0; c < chips && chip < CAIXIANLIN_FRAME_CHIPS; ++c, ++chip) {
+      if (level) {
+        frame[chip / 8] |= std::byte {static_cast<std::uint8_t>(0x80 >> (chip % 8))};
+      }
+    }
+  }
+
+  if (chip < CAIXIANLIN_FRAME_CHIPS) {
+    // A capture usually stops at the last edge, the final carrier-off pulse blends into the gap
+    bool endsOff = (count & 1) == 0;
+    if (endsOff || CAIXIANLIN_FRAME_CHIPS - chip > 3) {
+      return CaiXianlinParseResult::BadTiming;
+    }
+  }
+
+  return ParseCaiXianlinFrame(frame.data(), message);
+}
@@ -0,0 +1,186 @@
+#include "state-broadcaster.hpp"
+
+#include <cstdio>
+
+static_assert(WEBSOCKETS_SERVER_CLIENT_MAX <= 32, "Every client needs a bit in the subscriber masks");
+
+const char* CommandName(Command command) {
+  switch (command) {
+    case Command::Shock:
+      return "shock";
+    case Command::Vibrate:
+      return "vibrate";
+    case Command::Beep:
+      return "beep";
+    default:
+      return "none";
+  }
+}
+
+const char* ActionName(CollarAction action) {
+  switch (action) {
+    case CollarAction::Stop:
+      return "stop";
+    case CollarAction::Pattern:
+      return "pattern";
+    default:
+      return "cmd";
+  }
+}
+
+StateBroadcaster::StateBroadcaster()
+  : _state()
+  , _revision(0)
+  , _dirty(0)
+  , _dirtySince(0)
+  , _binaryClients(0)
+  , _textClients(0)
+  , _binaryFrame()
+  , _textFrame()
+  , _textLength(0)
+  , _stats() {
+  _state.command.action = CollarAction::Stop;
+}
+
+void StateBroadcaster::setCommand(const CollarCommand& command, std::uint32_t now) {
+  _state.command = command;
+  _markDirty(FIELD_COMMAND, now);
+}
+
+void StateBroadcaster::setApClientCount(std::uint8_t count, std::uint32_t now) {
+  if (count != _state.apClients) {
+    _state.apClients = count;
+    _markDirty(FIELD_AP_CLIENTS, now);
+  }
+}
+
+void StateBroadcaster::setTimeValid(bool valid, std::uint32_t now) {
+  if (valid != _state.timeValid) {
+    _state.timeValid = valid;
+    _markDirty(FIELD_TIME_VALID, now);
+  }
+}
+
+void StateBroadcaster::setFreeHeap(std::uint32_t freeHeap, std::uint32_t now) {
+  freeHeap -= freeHeap % HEAP_GRANULARITY;
+  if (freeHeap != _state.freeHeap) {
+    _state.freeHeap = freeHeap;
+    _markDirty(FIELD_FREE_HEAP, now);
+  }
+}
+
+void StateBroadcaster::subscribe(std::uint8_t clientId, bool binary, std::uint32_t now) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+
+  unsubscribe(clientId);
+  if (binary) {
+    _binaryClients |= 1UL << clientId;
+  } else {
+    _textClients |= 1UL << clientId;
+  }
+
+  // Existing subscribers see an unchanged snapshot once, which is cheaper than serializing a second frame
+  _markDirty(FIELD_ALL, now);
+}
+
+void StateBroadcaster::unsubscribe(std::uint8_t clientId) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+
+  _binaryClients &= ~(1UL << clientId);
+  _textClients &= ~(1UL << clientId);
+}
+
+bool StateBroadcaster::isSubscribed(std::uint8_t clientId, bool& binary) const {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return false;
+  }
+
+  binary = (_binaryClients & (1UL << clientId)) != 0;
+  return binary || (_textClients & (1UL << clientId)) != 0;
+}
+
+bool StateBroadcaster::update(std::uint32_t now, Broadcast& broadcast) {
+  if (_dirty == 0 || now - _dirtySince < COALESCE_MS) {
+    return false;
+  }
+
+  if (_binaryClients == 0 && _textClients == 0) {
+    _dirty = 0;
+    return false;
+  }
+
+  _revision++;
+
+  broadcast = {};
+  if (_binaryClients != 0) {
+    _encodeBinary();
+    _stats.broadcasts++;
+    broadcast.binaryClients = _binaryClients;
+    broadcast.binary        = _binaryFrame;
+    broadcast.binaryLength  = sizeof(_binaryFrame);
+  }
+  if (_textClients != 0) {
+    _encodeText();
+    _stats.broadcasts++;
+    broadcast.textClients = _textClients;
+    broadcast.text        = _textFrame;
+    broadcast.textLength  = _textLength;
+  }
+  _stats.deliveries += __builtin_popcount(_binaryClients) + __builtin_popcount(_textClients);
+
+  _dirty = 0;
+
+  return true;
+}
+
+void StateBroadcaster::_markDirty(std::uint8_t fields, std::uint32_t now) {
+  if (_dirty == 0) {
+    _dirtySince = now;
+  }
+  _dirty |= fields;
+  _stats.changes++;
+}
+
+void StateBroadcaster::_encodeBinary() {
+  const CollarCommand& command = _state.command;
+
+  _binaryFrame[0] = WsProtocol::VERSION;
+  _binaryFrame[1] = static_cast<std::uint8_t>(WsProtocol::Opcode::State);
+  WsProtocol::WriteU16(_binaryFrame + 2, _revision);
+  _binaryFrame[4] = _dirty;
+  _binaryFrame[5] = static_cast<std::uint8_t>(command.action);
+  WsProtocol::WriteU16(_binaryFrame + 6, command.transmitterId);
+  _binaryFrame[8]  = static_cast<std::uint8_t>(command.channel);
+  _binaryFrame[9]  = static_cast<std::uint8_t>(command.command);
+  _binaryFrame[10] = command.strength;
+  WsProtocol::WriteU16(_binaryFrame + 11, command.durationMs);
+  _binaryFrame[13] = _state.apClients;
+  _binaryFrame[14] = _state.timeValid ? 1 : 0;
+  WsProtocol::WriteU32(_binaryFrame + 15, _state.freeHeap);
+}
+
+void StateBroadcaster::_encodeText() {
+  const CollarCommand& command = _state.command;
+
+  int len = snprintf(_textFrame,
+                     sizeof(_textFrame),
+                     "{\"state\":%u,\"changed\":%u,\"op\":\"%s\",\"id\":%u,\"ch\":%u,\"cmd\":\"%s\",\"str\":%u,\"dur\":%u,"
+                     "\"ap\":%u,\"ntp\":%s,\"heap\":%u}",
+                     _revision,
+                     _dirty,
+                     ActionName(command.action),
+                     command.transmitterId,
+                     static_cast<unsigned>(command.channel),
+                     CommandName(command.command),
+                     command.strength,
+                     command.durationMs,
+                     _state.apClients,
+                     _state.timeValid ? "true" : "false",
+                     _state.freeHeap);
+
+  _textLength = (len < 0 || static_cast<std::size_t>(len) >= sizeof(_textFrame)) ? 0 : len;
+}
@@ -1,27 +1,80 @@
 #include "webservices.hpp"
 
+#include "captive-portal.hpp"
+#include "command-queue.hpp"
+#include "json-command-parser.hpp"
+#include "link-monitor.hpp"
 #include "logger.hpp"
+#include "rf-pattern.hpp"
+#include "rf-scheduler.hpp"
+#include "rf-transmitter.hpp"
 #include "sdcard-webhandler.hpp"
+#include "state-broadcaster.hpp"
+#include "wifi-ap.hpp"
+#include "wifi-profiles-webhandler.hpp"
+#include "ws-protocol.hpp"
+#include "ws-reassembler.hpp"
 
-#include <ArduinoJson.h>
 #include <ESP8266WebServer.h>
 #include <WebSocketsServer.h>
 
+#include <array>
 #include <memory>
 
 constexpr std::uint16_t HTTP_PORT      = 80;
 constexpr std::uint16_t WEBSOCKET_PORT = 81;
 
+// How often polled state (AP clients, free heap) is checked for changes
+constexpr std::uint32_t STATE_SAMPLE_INTERVAL_MS = 250;
+
+// A command that can't get its first frame on air within this time is dropped instead of arriving late
+constexpr std::uint32_t RF_COMMAND_DEADLINE_MS = 250;
+
+static_assert(WsProtocol::MAX_KEYFRAMES <= RfPattern::MAX_KEYFRAMES, "Every pattern the protocol carries must compile");
+
+// Queued commands executed per update, keeps a full queue from stalling the web server
+constexpr std::size_t COMMANDS_PER_UPDATE = 4;
+
 struct WebServicesInstance {
-  WebServicesInstance() : webServer(HTTP_PORT), socketServer(WEBSOCKET_PORT), sdWebHandler() { }
+  WebServicesInstance()
+    : webServer(HTTP_PORT)
+    , socketServer(WEBSOCKET_PORT)
+    , captivePortalHandler()
+    , wifiProfilesWebHandler()
+    , sdWebHandler()
+    , reassembler()
+    , commandQueue()
+    , rfPattern()
+    , rfPatternOwner(CommandQueue::NO_CLIENT)
+    , rfScheduler()
+    , stateBroadcaster()
+    , linkMonitor()
+    , lastStateSample(0) { }
 
   ESP8266WebServer webServer;
   WebSocketsServer socketServer;
+  CaptivePortalHandler captivePortalHandler;
+  WiFiProfilesWebHandler wifiProfilesWebHandler;
   SDCardWebHandler sdWebHandler;
+  WsReassembler reassembler;
+  CommandQueue commandQueue;
+  RfPattern rfPattern;          // Only one pattern plays at a time, one for another collar is refused while it does
+  std::uint8_t rfPatternOwner;  // Socket that sent the pattern, it stops when that client goes away
+  RfScheduler rfScheduler;
+  StateBroadcaster stateBroadcaster;
+  LinkMonitor linkMonitor;
+  std::uint32_t lastStateSample;
 };
 std::unique_ptr<WebServicesInstance> s_webServices = nullptr;
 
+WebServices::CommandStats s_binaryCommandStats = {};
+WebServices::CommandStats s_jsonCommandStats   = {};
+
 void handleWebSocketEvent(std::uint8_t socketId, WStype_t type, std::uint8_t* data, std::size_t len);
+void executeQueuedCommands();
+void stopClientPattern(std::uint8_t socketId);
+void publishState();
+void monitorLinks();
 
 void WebServices::Start() {
   if (s_webServices != nullptr) {
@@ -36,6 +89,13 @@ void WebServices::Start() {
   s_webServices->socketServer.onEvent(handleWebSocketEvent);
   s_webServices->socketServer.begin();
 
+  // Request headers are only stored by the web server if they are collected explicitly
+  const char* headerKeys[] = {"Range"};
+  s_webServices->webServer.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+  // Handlers are tried in the order they are added, probes and the API must be answered before the SD card is consulted
+  s_webServices->webServer.addHandler(&s_webServices->captivePortalHandler);
+  s_webServices->webServer.addHandler(&s_webServices->wifiProfilesWebHandler);
   s_webServices->webServer.addHandler(&s_webServices->sdWebHandler);
   s_webServices->webServer.begin();
 }
@@ -55,59 +115,395 @@ void WebServices::Stop() {
 bool WebServices::IsRunning() {
   return s_webServices != nullptr;
 }
+const WebServices::CommandStats& WebServices::GetBinaryCommandStats() {
+  return s_binaryCommandStats;
+}
+const WebServices::CommandStats& WebServices::GetJsonCommandStats() {
+  return s_jsonCommandStats;
+}
+const CommandQueue::Stats& WebServices::GetCommandQueueStats() {
+  static const CommandQueue::Stats s_emptyStats = {};
+  return s_webServices != nullptr ? s_webServices->commandQueue.stats() : s_emptyStats;
+}
+const RfScheduler::Stats& WebServices::GetRfSchedulerStats() {
+  static const RfScheduler::Stats s_emptyStats = {};
+  return s_webServices != nullptr ? s_webServices->rfScheduler.stats() : s_emptyStats;
+}
+const AssetCache::Stats& WebServices::GetAssetCacheStats() {
+  static const AssetCache::Stats s_emptyStats = {};
+  return s_webServices != nullptr ? s_webServices->sdWebHandler.cacheStats() : s_emptyStats;
+}
+const SDCardWebHandler::StreamStats& WebServices::GetStreamStats() {
+  static const SDCardWebHandler::StreamStats s_emptyStats = {};
+  return s_webServices != nullptr ? s_webServices->sdWebHandler.streamStats() : s_emptyStats;
+}
+void WebServices::SetTimeValid(bool valid) {
+  if (s_webServices == nullptr) {
+    return;
+  }
+
+  s_webServices->stateBroadcaster.setTimeValid(valid, millis());
+}
 void WebServices::Update() {
   if (s_webServices == nullptr) {
     return;
   }
 
-  s_webServices->webServer.handleClient();
+  // The web server only parses requests and sends headers, response bodies are interleaved by the SD card handler.
+  // While all of its transfer slots are taken, new connections wait in the listen backlog instead of being answered
+  if (!s_webServices->sdWebHandler.busy()) {
+    s_webServices->webServer.handleClient();
+  }
+  s_webServices->sdWebHandler.update();
   s_webServices->socketServer.loop();
+  s_webServices->reassembler.expire(millis());
+
+  // Commands are only queued by the socket callbacks, execution happens here
+  executeQueuedCommands();
+
+  // The next frame waits in the transmitter, whose interrupt starts it as soon as the one on air has ended
+  RfScheduler& scheduler = s_webServices->rfScheduler;
+  if (RfTransmitter::CanQueue()) {
+    const RfScheduler::Frame* frame = scheduler.next(millis());
+    if (frame != nullptr && !RfTransmitter::Queue(frame->data(), frame->size(), RfScheduler::Protocol::CHIP_US)) {
+      scheduler.unsend();
+    }
+  }
+
+  publishState();
+  monitorLinks();
+}
+
+void publishState() {
+  StateBroadcaster& broadcaster = s_webServices->stateBroadcaster;
+  std::uint32_t now             = millis();
+
+  if (now - s_webServices->lastStateSample >= STATE_SAMPLE_INTERVAL_MS) {
+    s_webServices->lastStateSample = now;
+    broadcaster.setApClientCount(WiFi_AP::GetClientCount(), now);
+    broadcaster.setFreeHeap(ESP.getFreeHeap(), now);
+  }
+
+  StateBroadcaster::Broadcast broadcast;
+  if (!broadcaster.update(now, broadcast)) {
+    return;
+  }
+
+  // Every subscriber is sent the same serialized frame
+  WebSocketsServer& socketServer = s_webServices->socketServer;
+  for (std::uint8_t socketId = 0; socketId < WEBSOCKETS_SERVER_CLIENT_MAX; ++socketId) {
+    std::uint32_t bit = 1UL << socketId;
+    if ((broadcast.binaryClients & bit) != 0) {
+      socketServer.sendBIN(socketId, broadcast.binary, broadcast.binaryLength);
+    } else if ((broadcast.textClients & bit) != 0 && broadcast.textLength > 0) {
+      socketServer.sendTXT(socketId, broadcast.text, broadcast.textLength);
+    }
+  }
+}
+
+void monitorLinks() {
+  LinkMonitor::Actions actions;
+  s_webServices->linkMonitor.update(millis(), actions);
+  if (actions.ping == 0 && actions.drop == 0) {
+    return;
+  }
+
+  WebSocketsServer& socketServer = s_webServices->socketServer;
+  for (std::uint8_t socketId = 0; socketId < WEBSOCKETS_SERVER_CLIENT_MAX; ++socketId) {
+    std::uint32_t bit = 1UL << socketId;
+    if ((actions.drop & bit) != 0) {
+      Logger::printlnf("WebSocket client #%u silent for too long, disconnecting", socketId);
+      stopClientPattern(socketId);
+      socketServer.disconnect(socketId);
+    } else if ((actions.ping & bit) != 0) {
+      std::uint8_t payload[LinkMonitor::PING_PAYLOAD_SIZE];
+      s_webServices->linkMonitor.encodePing(payload, micros());
+      socketServer.sendPing(socketId, payload, sizeof(payload));
+    }
+  }
+}
+void sendLatencyReport(std::uint8_t socketId) {
+  bool binary;
+  if (!s_webServices->stateBroadcaster.isSubscribed(socketId, binary)) {
+    return;
+  }
+
+  LinkMonitor::Report report = s_webServices->linkMonitor.report(socketId);
+  if (binary) {
+    std::array<std::uint8_t, WsProtocol::LATENCY_SIZE> frame;
+    frame[0] = WsProtocol::VERSION;
+    frame[1] = static_cast<std::uint8_t>(WsProtocol::Opcode::Latency);
+    WsProtocol::WriteU16(frame.data() + 2, 0);
+    WsProtocol::WriteU16(frame.data() + 4, report.lastMs);
+    WsProtocol::WriteU16(frame.data() + 6, report.p50Ms);
+    WsProtocol::WriteU16(frame.data() + 8, report.p99Ms);
+    WsProtocol::WriteU16(frame.data() + 10, report.samples);
+    s_webServices->socketServer.sendBIN(socketId, frame.data(), frame.size());
+    return;
+  }
+
+  char text[64];
+  int len = snprintf(text,
+                     sizeof(text),
+                     "{\"rtt\":%u,\"p50\":%u,\"p99\":%u,\"n\":%u}",
+                     report.lastMs,
+                     report.p50Ms,
+                     report.p99Ms,
+                     report.samples);
+  if (len > 0 && static_cast<std::size_t>(len) < sizeof(text)) {
+    s_webServices->socketServer.sendTXT(socketId, text, len);
+  }
 }
 
 void handleWebSocketClientConnected(std::uint8_t socketId) {
   Logger::printlnf(
     "WebSocket client #%u connected from %s", socketId, s_webServices->socketServer.remoteIP(socketId).toString().c_str());
+  s_webServices->linkMonitor.connect(socketId, millis());
 }
 void handleWebSocketClientDisconnected(std::uint8_t socketId) {
   Logger::printlnf("WebSocket client #%u disconnected", socketId);
+  s_webServices->linkMonitor.disconnect(socketId);
+  s_webServices->reassembler.drop(socketId);
+  s_webServices->stateBroadcaster.unsubscribe(socketId);
+  s_webServices->commandQueue.removeClient(socketId);
+  stopClientPattern(socketId);
 }
-void handleWebSocketClientMessage(std::uint8_t socketId, WStype_t type, std::uint8_t* data, std::size_t len) {
-  (void)socketId;
+void recordCommandLatency(WebServices::CommandStats& stats, std::uint32_t arrivalMicros) {
+  std::uint32_t elapsed = micros() - arrivalMicros;
 
-  if (type == WStype_t::WStype_TEXT) {
-    Logger::printlnf("WebSocket client #%u sent text message", socketId);
-  } else if (type == WStype_t::WStype_BIN) {
-    Logger::printlnf("WebSocket client #%u sent binary message", socketId);
-  } else {
-    Logger::printlnf("WebSocket client #%u sent unknown message type %u", socketId, type);
+  stats.count++;
+  stats.totalMicros += elapsed;
+  stats.maxMicros = std::max(stats.maxMicros, elapsed);
+}
+bool executeCommand(const CollarCommand& command) {
+  RfScheduler& scheduler = s_webServices->rfScheduler;
+
+  if (command.action == CollarAction::Stop) {
+    if (scheduler.stop(command.transmitterId, command.channel, millis())) {
+      RfTransmitter::Stop();
+    }
+    return true;
+  }
+
+  return scheduler.submit(command, millis(), RF_COMMAND_DEADLINE_MS);
+}
+WsProtocol::Status executePattern(std::uint8_t socketId, const WsProtocol::Message& message) {
+  RfScheduler& scheduler       = s_webServices->rfScheduler;
+  RfPattern& pattern           = s_webServices->rfPattern;
+  const CollarCommand& command = message.command;
+
+  // Replacing the pattern of another collar would silently end it for whoever started it
+  bool playing = scheduler.scheduled(pattern);
+  if (playing && (pattern.transmitterId() != command.transmitterId || pattern.channel() != command.channel)) {
+    return WsProtocol::Status::Busy;
+  }
+
+  // Executed right away, but rate limited like any other stimulus command
+  if (!s_webServices->commandQueue.admit(socketId, millis())) {
+    return WsProtocol::Status::RateLimited;
+  }
+
+  // The pattern is compiled in place, the collar still playing it has to let go first
+  if (playing && scheduler.stop(pattern, millis())) {
+    RfTransmitter::Stop();
+  }
+
+  CollarKeyframe keyframes[WsProtocol::MAX_KEYFRAMES];
+  for (std::size_t i = 0; i < message.keyframeCount; ++i) {
+    keyframes[i] = WsProtocol::ReadKeyframe(message.keyframes + i * WsProtocol::KEYFRAME_SIZE);
+  }
+
+  if (!pattern.compile(command.transmitterId, command.channel, keyframes, message.keyframeCount, message.patternLoops)
+      || !scheduler.submit(pattern, millis(), RF_COMMAND_DEADLINE_MS)) {
+    return WsProtocol::Status::InvalidCommand;
+  }
+
+  s_webServices->rfPatternOwner = socketId;
+  return WsProtocol::Status::Ok;
+}
+void stopClientPattern(std::uint8_t socketId) {
+  if (s_webServices->rfPatternOwner != socketId) {
+    return;
+  }
+  s_webServices->rfPatternOwner = CommandQueue::NO_CLIENT;
+
+  RfPattern& pattern = s_webServices->rfPattern;
+  if (!s_webServices->rfScheduler.scheduled(pattern)) {
+    return;
+  }
+
+  Logger::printlnf("[WebServices] Stopping the pattern of WebSocket client #%u", socketId);
+  if (s_webServices->rfScheduler.stop(pattern, millis())) {
+    RfTransmitter::Stop();
+  }
+
+  CollarCommand stop = {CollarAction::Stop, pattern.transmitterId(), pattern.channel(), Command {}, 0, 0};
+  s_webServices->stateBroadcaster.setCommand(stop, millis());
+}
+void sendAck(std::uint8_t socketId, bool binary, std::uint16_t sequence, WsProtocol::Status status) {
+  if (binary) {
+    std::array<std::uint8_t, WsProtocol::ACK_SIZE> ack;
+    WsProtocol::EncodeAck(sequence, status, ack);
+    s_webServices->socketServer.sendBIN(socketId, ack.data(), ack.size());
+    return;
+  }
+
+  char ack[JsonCommandParser::MAX_ACK_SIZE];
+  std::size_t ackLen = JsonCommandParser::EncodeAck(sequence, status, ack, sizeof(ack));
+  if (ackLen > 0) {
+    s_webServices->socketServer.sendTXT(socketId, reinterpret_cast<std::uint8_t*>(ack), ackLen);
+  }
+}
+void executeQueuedCommands() {
+  CommandQueue::Entry entry;
+  for (std::size_t i = 0; i < COMMANDS_PER_UPDATE && s_webServices->commandQueue.pop(entry); ++i) {
+    WebServices::CommandStats& stats = entry.binary ? s_binaryCommandStats : s_jsonCommandStats;
+
+    WsProtocol::Status status = WsProtocol::Status::InvalidCommand;
+    if (executeCommand(entry.message.command)) {
+      status = WsProtocol::Status::Ok;
+      recordCommandLatency(stats, entry.arrivalMicros);
+      s_webServices->stateBroadcaster.setCommand(entry.message.command, millis());
+    } else {
+      stats.rejected++;
+    }
+
+    if (entry.clientId != CommandQueue::NO_CLIENT) {
+      sendAck(entry.clientId, entry.binary, entry.message.sequence, status);
+    }
+  }
+}
+void handleMessage(std::uint8_t socketId, const WsProtocol::Message& message, bool binary, std::uint32_t arrivalMicros) {
+  WsProtocol::Status status = WsProtocol::Status::Ok;
+  switch (message.opcode) {
+    case WsProtocol::Opcode::Subscribe:
+      s_webServices->stateBroadcaster.subscribe(socketId, binary, millis());
+      break;
+    case WsProtocol::Opcode::Unsubscribe:
+      s_webServices->stateBroadcaster.unsubscribe(socketId);
+      break;
+    case WsProtocol::Opcode::Pattern:
+      // Executed right away, the keyframes are read from the socket's buffer and can't wait in the queue
+      status = executePattern(socketId, message);
+      if (status == WsProtocol::Status::Ok) {
+        recordCommandLatency(binary ? s_binaryCommandStats : s_jsonCommandStats, arrivalMicros);
+        s_webServices->stateBroadcaster.setCommand(message.command, millis());
+      } else {
+        (binary ? s_binaryCommandStats : s_jsonCommandStats).rejected++;
+      }
+      break;
+    default:
+      switch (s_webServices->commandQueue.push({socketId, binary, arrivalMicros, message}, millis())) {
+        case CommandQueue::Admission::Queued:
+          return;  // Acknowledged once executed
+        case CommandQueue::Admission::RateLimited:
+          status = WsProtocol::Status::RateLimited;
+          break;
+        case CommandQueue::Admission::QueueFull:
+          status = WsProtocol::Status::QueueFull;
+          break;
+      }
+      (binary ? s_binaryCommandStats : s_jsonCommandStats).rejected++;
+      break;
+  }
+
+  sendAck(socketId, binary, message.sequence, status);
+}
+void handleWebSocketBinaryMessage(std::uint8_t socketId, std::uint8_t* data, std::size_t len, std::uint32_t arrivalMicros) {
+  WsProtocol::Message message;
+  WsProtocol::Status status = WsProtocol::Decode(data, len, message);
+  if (status == WsProtocol::Status::Ok) {
+    handleMessage(socketId, message, true, arrivalMicros);
+    return;
+  }
+
+  s_binaryCommandStats.rejected++;
+
+  // Frames too short to carry a sequence number can't be acknowledged
+  if (status == WsProtocol::Status::Malformed && len < WsProtocol::HEADER_SIZE) {
+    return;
   }
 
-  if (type != WStype_t::WStype_TEXT) {
+  sendAck(socketId, true, message.sequence, status);
+}
+void handleWebSocketTextMessage(std::uint8_t socketId, std::uint8_t* data, std::size_t len, std::uint32_t arrivalMicros) {
+  WsProtocol::Message message;
+  WsProtocol::Status status = JsonCommandParser::Parse(reinterpret_cast<const char*>(data), len, message);
+  if (status == WsProtocol::Status::Ok) {
+    handleMessage(socketId, message, false, arrivalMicros);
     return;
   }
 
-  StaticJsonDocument<256> doc;
-  auto err = deserializeJson(doc, data, len);
-  if (err) {
-    Logger::printlnf("Failed to deserialize message: %s", err.c_str());
+  s_jsonCommandStats.rejected++;
+  sendAck(socketId, false, message.sequence, status);
+}
+void handleWebSocketFragment(std::uint8_t socketId, WStype_t type, std::uint8_t* data, std::size_t len) {
+  WsReassembler& reassembler = s_webServices->reassembler;
+
+  WsReassembler::Result result;
+  WsReassembler::Message message;
+  switch (type) {
+    case WStype_FRAGMENT_BIN_START:
+    case WStype_FRAGMENT_TEXT_START:
+      result = reassembler.begin(socketId, type == WStype_FRAGMENT_BIN_START, data, len, millis());
+      break;
+    default:
+      result = reassembler.append(socketId, data, len, type == WStype_FRAGMENT_FIN, millis(), message);
+      break;
+  }
+
+  if (result == WsReassembler::Result::Dropped) {
+    Logger::printlnf("WebSocket client #%u fragmented message dropped", socketId);
+    return;
+  }
+  if (result != WsReassembler::Result::Complete) {
     return;
   }
 
-  String str;
-  serializeJsonPretty(doc, str);
-  Logger::printlnf("Message: %s", str.c_str());
+  // The handlers take mutable buffers but only read from them
+  std::uint8_t* payload = const_cast<std::uint8_t*>(message.data);
+  if (message.binary) {
+    handleWebSocketBinaryMessage(socketId, payload, message.length, micros());
+  } else {
+    handleWebSocketTextMessage(socketId, payload, message.length, micros());
+  }
+  reassembler.release(socketId);
 }
 void handleWebSocketClientPing(std::uint8_t socketId) {
   Logger::printlnf("WebSocket client #%u ping received", socketId);
 }
-void handleWebSocketClientPong(std::uint8_t socketId) {
-  Logger::printlnf("WebSocket client #%u pong received", socketId);
+void handleWebSocketClientPong(std::uint8_t socketId, std::uint8_t* data, std::size_t len) {
+  if (s_webServices->linkMonitor.pong(socketId, data, len, micros(), millis())) {
+    sendLatencyReport(socketId);
+  }
 }
 void handleWebSocketClientError(std::uint8_t socketId, uint16_t code, const char* message) {
   Logger::printlnf("WebSocket client #%u error %u: %s", socketId, code, message);
 }
 
 void handleWebSocketEvent(std::uint8_t socketId, WStype_t type, std::uint8_t* data, std::size_t len) {
+  s_webServices->linkMonitor.heard(socketId, millis());
+
+  // Command frames and heartbeats are the hot path, keep SD card logging out of it
+  if (type == WStype_BIN) {
+    handleWebSocketBinaryMessage(socketId, data, len, micros());
+    return;
+  }
+  if (type == WStype_TEXT) {
+    handleWebSocketTextMessage(socketId, data, len, micros());
+    return;
+  }
+  if (type == WStype_PONG) {
+    handleWebSocketClientPong(socketId, data, len);
+    return;
+  }
+  if (type == WStype_FRAGMENT_BIN_START || type == WStype_FRAGMENT_TEXT_START || type == WStype_FRAGMENT
+      || type == WStype_FRAGMENT_FIN)
+  {
+    handleWebSocketFragment(socketId, type, data, len);
+    return;
+  }
+
   Logger::printlnf("WebSocket event: %u", type);
   switch (type) {
     case WStype_CONNECTED:
@@ -116,20 +512,9 @@ void handleWebSocketEvent(std::uint8_t socketId, WStype_t type, std::uint8_t* da
     case WStype_DISCONNECTED:
       handleWebSocketClientDisconnected(socketId);
       break;
-    case WStype_BIN:
-    case WStype_TEXT:
-    case WStype_FRAGMENT_BIN_START:
-    case WStype_FRAGMENT_TEXT_START:
-    case WStype_FRAGMENT:
-    case WStype_FRAGMENT_FIN:
-      handleWebSocketClientMessage(socketId, type, data, len);
-      break;
     case WStype_PING:
       handleWebSocketClientPing(socketId);
       break;
-    case WStype_PONG:
-      handleWebSocketClientPong(socketId);
-      break;
     case WStype_ERROR:
       handleWebSocketClientError(socketId, len, reinterpret_cast<char*>(data));
       break;
@@ -0,0 +1,63 @@
+#include "wifi-profiles-webhandler.hpp"
+
+#include "wifi-profiles.hpp"
+#include "wifi-sta.hpp"
+
+#include <ArduinoJson.h>
+
+constexpr const char* PROFILES_PATH = "/api/wifi/profiles";
+
+constexpr std::size_t PROFILES_LIST_DOCUMENT_SIZE = 1024;
+
+bool WiFiProfilesWebHandler::canHandle(HTTPMethod method, const String& uri) {
+  return (method == HTTP_GET || method == HTTP_POST || method == HTTP_DELETE) && uri == PROFILES_PATH;
+}
+
+bool WiFiProfilesWebHandler::handle(WebServerType& server, HTTPMethod requestMethod, const String& requestUri) {
+  (void)requestUri;
+
+  server.sendHeader(F("Cache-Control"), F("no-store"));
+
+  if (requestMethod == HTTP_GET) {
+    _list(server);
+    return true;
+  }
+
+  if (!server.hasArg(F("ssid"))) {
+    server.send(400, "text/plain", "Missing ssid");
+    return true;
+  }
+
+  const String& ssid = server.arg(F("ssid"));
+  if (requestMethod == HTTP_DELETE) {
+    if (!WiFi_STA::RemoveProfile(ssid.c_str())) {
+      server.send(404, "text/plain", "Unknown network");
+      return true;
+    }
+  } else if (!WiFi_STA::AddProfile(ssid.c_str(), server.arg(F("psk")).c_str())) {
+    server.send(400, "text/plain", "Unable to add network");
+    return true;
+  }
+
+  _list(server);
+  return true;
+}
+
+void WiFiProfilesWebHandler::_list(WebServerType& server) {
+  const WiFiProfiles& profiles = WiFi_STA::GetProfiles();
+
+  DynamicJsonDocument doc = DynamicJsonDocument(PROFILES_LIST_DOCUMENT_SIZE);
+  JsonArray networks      = doc.createNestedArray("networks");
+  for (std::size_t i = 0; i < profiles.count(); ++i) {
+    const WiFiProfiles::Profile& profile = profiles.at(i);
+    JsonObject network                   = networks.createNestedObject();
+    network["ssid"]                      = profile.ssid;
+    network["attempts"]                  = profile.attempts;
+    network["successes"]                 = profile.successes;
+    network["failures"]                  = profile.failures;
+  }
+
+  String body;
+  serializeJson(doc, body);
+  server.send(200, "application/json", body);
+}
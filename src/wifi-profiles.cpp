@@ -0,0 +1,198 @@
+#include "wifi-profiles.hpp"
+
+#include "crypto-msgpack.hpp"
+#include "logger.hpp"
+#include "sdcard.hpp"
+
+#include <ArduinoJson.h>
+#include <ESP8266WiFi.h>
+
+#include <cstring>
+
+constexpr const char* PROFILES_FILE_NAME = "/config/wifi-profiles.bin";
+
+constexpr std::size_t PROFILES_DOCUMENT_SIZE = 2048;
+
+WiFiProfiles::WiFiProfiles()
+  : _profiles()
+  , _count(0)
+  , _dirty(false) { }
+
+bool WiFiProfiles::Exists() {
+  return SDCard::Exists(PROFILES_FILE_NAME);
+}
+
+bool WiFiProfiles::load() {
+  _count = 0;
+
+  DynamicJsonDocument doc = DynamicJsonDocument(PROFILES_DOCUMENT_SIZE);
+  if (!ReadEncryptedMsgPackFile(PROFILES_FILE_NAME, doc)) {
+    return false;
+  }
+
+  JsonArrayConst networks = doc["networks"];
+  for (JsonObjectConst network : networks) {
+    const char* ssid = network["ssid"];
+    const char* psk  = network["psk"];
+    if (ssid == nullptr || psk == nullptr || !add(ssid, psk)) {
+      Logger::println("[WiFiProfiles] Skipping invalid profile");
+      continue;
+    }
+
+    Profile& profile  = _profiles[_count - 1];
+    profile.attempts  = network["attempts"];
+    profile.successes = network["successes"];
+    profile.failures  = network["failures"];
+    if (profile.successes > profile.attempts) {
+      profile.successes = profile.attempts;
+    }
+  }
+
+  _dirty = false;
+  return true;
+}
+
+bool WiFiProfiles::save() {
+  DynamicJsonDocument doc = DynamicJsonDocument(PROFILES_DOCUMENT_SIZE);
+
+  JsonArray networks = doc.createNestedArray("networks");
+  for (std::size_t i = 0; i < _count; ++i) {
+    const Profile& profile = _profiles[i];
+    JsonObject network     = networks.createNestedObject();
+    network["ssid"]        = profile.ssid;
+    network["psk"]         = profile.psk;
+    network["attempts"]    = profile.attempts;
+    network["successes"]   = profile.successes;
+    network["failures"]    = profile.failures;
+  }
+
+  if (!WriteEncryptedMsgPackFile(PROFILES_FILE_NAME, doc)) {
+    Logger::println("[WiFiProfiles] Failed to save profiles");
+    return false;
+  }
+
+  _dirty = false;
+  return true;
+}
+
+bool WiFiProfiles::add(const char* ssid, const char* psk) {
+  std::size_t ssidLength = std::strlen(ssid);
+  std::size_t pskLength  = std::strlen(psk);
+  if (ssidLength == 0 || ssidLength > MAX_SSID_LENGTH || pskLength > MAX_PSK_LENGTH) {
+    return false;
+  }
+
+  // Adding a known network only replaces its key, the record of how well it worked stays
+  std::size_t index = find(ssid);
+  if (index == MAX_PROFILES) {
+    if (_count == MAX_PROFILES) {
+      Logger::printlnf("[WiFiProfiles] Unable to add %s, all %u profiles are in use",
+                       ssid,
+                       static_cast<unsigned>(MAX_PROFILES));
+      return false;
+    }
+
+    index             = _count++;
+    Profile& profile  = _profiles[index];
+    profile.ssidHash  = HashSsid(reinterpret_cast<const std::uint8_t*>(ssid), ssidLength);
+    profile.attempts  = 0;
+    profile.successes = 0;
+    profile.failures  = 0;
+    std::memcpy(profile.ssid, ssid, ssidLength + 1);
+  }
+
+  std::memcpy(_profiles[index].psk, psk, pskLength + 1);
+  _dirty = true;
+
+  return true;
+}
+
+bool WiFiProfiles::remove(const char* ssid) {
+  std::size_t index = find(ssid);
+  if (index == MAX_PROFILES) {
+    return false;
+  }
+
+  _count--;
+  for (std::size_t i = index; i < _count; ++i) {
+    _profiles[i] = _profiles[i + 1];
+  }
+  _dirty = true;
+
+  return true;
+}
+
+std::size_t WiFiProfiles::find(const char* ssid) const {
+  std::size_t length = std::strlen(ssid);
+  return _find(HashSsid(reinterpret_cast<const std::uint8_t*>(ssid), length),
+               reinterpret_cast<const std::uint8_t*>(ssid),
+               length);
+}
+
+WiFiProfiles::Candidate WiFiProfiles::select(std::int8_t networksFound) const {
+  Candidate best = {-1, MAX_PROFILES, INT32_MIN};
+
+  for (std::int8_t i = 0; i < networksFound; ++i) {
+    const bss_info* info = WiFi.getScanInfoByIndex(i);
+    if (info == nullptr || info->ssid_len == 0 || info->ssid_len > MAX_SSID_LENGTH) {
+      continue;
+    }
+
+    std::size_t index = _find(HashSsid(info->ssid, info->ssid_len), info->ssid, info->ssid_len);
+    if (index == MAX_PROFILES) {
+      continue;
+    }
+
+    // Laplace smoothed success rate, a network without history starts halfway
+    const Profile& profile = _profiles[index];
+    std::int32_t success   = SUCCESS_WEIGHT_DB * (profile.successes + 1) / (profile.attempts + 2);
+    std::int32_t score     = info->rssi + success - FAILURE_PENALTY_DB * profile.failures;
+    if (score > best.score) {
+      best = {i, index, score};
+    }
+  }
+
+  return best;
+}
+
+bool WiFiProfiles::recordResult(std::size_t index, bool connected) {
+  Profile& profile = _profiles[index];
+  bool reranked    = !connected || profile.failures > 0;
+
+  // Halving both keeps the rate while letting old results fade
+  if (profile.attempts == UINT8_MAX) {
+    profile.attempts  = profile.attempts / 2;
+    profile.successes = profile.successes / 2;
+  }
+
+  profile.attempts++;
+  if (connected) {
+    profile.successes++;
+    profile.failures = 0;
+  } else if (profile.failures < UINT8_MAX) {
+    profile.failures++;
+  }
+  _dirty = true;
+
+  return reranked;
+}
+
+std::uint32_t WiFiProfiles::HashSsid(const std::uint8_t* ssid, std::size_t length) {
+  // FNV-1a
+  std::uint32_t hash = 2'166'136'261;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash = (hash ^ ssid[i]) * 16'777'619;
+  }
+  return hash;
+}
+
+std::size_t WiFiProfiles::_find(std::uint32_t hash, const std::uint8_t* ssid, std::size_t length) const {
+  for (std::size_t i = 0; i < _count; ++i) {
+    const Profile& profile = _profiles[i];
+    if (profile.ssidHash == hash && std::strlen(profile.ssid) == length
+        && std::memcmp(profile.ssid, ssid, length) == 0) {
+      return i;
+    }
+  }
+  return MAX_PROFILES;
+}
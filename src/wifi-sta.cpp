@@ -0,0 +1,367 @@
+#include "wifi-sta.hpp"
+
+#include "crypto-msgpack.hpp"
+#include "logger.hpp"
+#include "wifi-profiles.hpp"
+
+#include <ArduinoJson.h>
+#include <ESP8266WiFi.h>
+
+#include <cstdio>
+#include <cstring>
+
+enum class StaState {
+  Stopped,
+  Connecting,
+  Scanning,
+  Waiting,  // For the next attempt after nothing could be connected to
+  Connected,
+};
+
+// The key isn't cached, it is taken from the profile, so removing the profile also stops the cached connection
+struct StaConnection {
+  char ssid[33];
+  std::uint8_t bssid[6];
+  std::uint8_t channel;
+};
+
+constexpr const char* STA_CACHE_FILE_NAME = "/config/wifi-sta.bin";
+
+constexpr std::uint32_t STA_CACHED_CONNECT_TIMEOUT_MS = 4000;
+constexpr std::uint32_t STA_CONNECT_TIMEOUT_MS        = 15'000;
+constexpr std::uint32_t STA_RETRY_INTERVAL_MS         = 30'000;
+constexpr std::uint32_t STA_PROFILES_SAVE_INTERVAL_MS = 3'600'000;  // For counters that don't change the ranking
+
+StaState staState = StaState::Stopped;
+StaConnection staConnection;
+WiFiProfiles staProfiles;
+bool staCached                 = false;  // staConnection holds a connection that worked before
+bool staProfilesWritable       = false;  // The profiles were loaded, or there is no file yet that could be lost
+bool staUsingCache             = false;
+std::uint32_t staStarted       = 0;  // millis() when the current attempt to get connected began
+std::uint32_t staDeadline      = 0;
+std::uint32_t staProfilesSaved = 0;
+std::size_t staProfile         = WiFiProfiles::MAX_PROFILES;  // Profile of the current attempt
+std::size_t staAttempts        = 0;                           // Scanned attempts since startConnecting()
+
+void saveProfiles() {
+  staProfilesSaved = millis();
+  staProfiles.save();
+}
+
+void saveConnection() {
+  char bssid[18];
+  const std::uint8_t* mac = staConnection.bssid;
+  snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  DynamicJsonDocument doc = DynamicJsonDocument(256);
+  doc["ssid"]    = staConnection.ssid;
+  doc["bssid"]   = bssid;
+  doc["channel"] = staConnection.channel;
+
+  if (!WriteEncryptedMsgPackFile(STA_CACHE_FILE_NAME, doc)) {
+    Logger::println("[WiFi_STA] Failed to cache connection");
+  }
+}
+
+bool loadConnection(bool profilesExist) {
+  DynamicJsonDocument doc = DynamicJsonDocument(256);
+  if (!ReadEncryptedMsgPackFile(STA_CACHE_FILE_NAME, doc)) {
+    return false;
+  }
+
+  const char* ssid  = doc["ssid"];
+  const char* bssid = doc["bssid"];
+  if (ssid == nullptr || bssid == nullptr || std::strlen(ssid) >= sizeof(staConnection.ssid)) {
+    Logger::println("[WiFi_STA] Cached connection is incomplete");
+    return false;
+  }
+
+  std::uint8_t* mac = staConnection.bssid;
+  if (sscanf(bssid, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != 6) {
+    Logger::println("[WiFi_STA] Cached connection has an invalid BSSID");
+    return false;
+  }
+
+  std::strcpy(staConnection.ssid, ssid);
+  staConnection.channel = doc["channel"];
+  if (staConnection.channel < 1 || staConnection.channel > 14) {
+    return false;
+  }
+
+  // Connections cached before there were profiles carry the key. Without a profiles file it becomes the first profile,
+  // either way the cache is rewritten without it. Profiles that exist but couldn't be read are never overwritten
+  const char* psk = doc["psk"];
+  if (psk != nullptr && staProfilesWritable) {
+    if (profilesExist || (staProfiles.add(ssid, psk) && staProfiles.save())) {
+      saveConnection();
+    }
+  }
+
+  return true;
+}
+
+void waitToRetry() {
+  staState    = StaState::Waiting;
+  staDeadline = millis() + STA_RETRY_INTERVAL_MS;
+}
+
+void handleScanResult(std::int8_t networksFound) {
+  Logger::printlnf("[WiFi_STA] Scan complete, found %d networks", networksFound);
+
+  // A single pass over the results matches them against the profiles and ranks them
+  WiFiProfiles::Candidate candidate = staProfiles.select(networksFound);
+  if (candidate.scanIndex < 0) {
+    Logger::println("[WiFi_STA] No known network found");
+    WiFi.scanDelete();
+    waitToRetry();
+    return;
+  }
+
+  const WiFiProfiles::Profile& profile = staProfiles.at(candidate.profile);
+  const bss_info* info                 = WiFi.getScanInfoByIndex(candidate.scanIndex);
+
+  Logger::printlnf("[WiFi_STA] Connecting to %s on channel %u (%d dBm, %u of %u attempts worked)",
+                   profile.ssid,
+                   info->channel,
+                   info->rssi,
+                   profile.successes,
+                   profile.attempts);
+
+  // The cached access point and channel only belong to the network they were cached for
+  if (std::strcmp(staConnection.ssid, profile.ssid) != 0) {
+    staCached = false;
+  }
+  std::strcpy(staConnection.ssid, profile.ssid);
+  staProfile = candidate.profile;
+
+  WiFi.begin(profile.ssid, profile.psk, info->channel, info->bssid);
+  WiFi.scanDelete();
+
+  staState      = StaState::Connecting;
+  staUsingCache = false;
+  staDeadline   = millis() + STA_CONNECT_TIMEOUT_MS;
+}
+
+void startScan() {
+  WiFi.scanDelete();
+
+  std::int8_t scanResult = WiFi.scanNetworks(true);
+  if (scanResult == WIFI_SCAN_RUNNING) {
+    Logger::println("[WiFi_STA] Scanning for networks");
+    staState = StaState::Scanning;
+    return;
+  }
+
+  if (scanResult == WIFI_SCAN_FAILED) {
+    Logger::println("[WiFi_STA] Failed to start scan");
+    waitToRetry();
+    return;
+  }
+
+  handleScanResult(scanResult);
+}
+
+void connectCached() {
+  staProfile = staProfiles.find(staConnection.ssid);
+  if (staProfile == WiFiProfiles::MAX_PROFILES) {
+    Logger::printlnf("[WiFi_STA] Profile of %s was removed, scanning", staConnection.ssid);
+    staCached = false;
+    startScan();
+    return;
+  }
+
+  Logger::printlnf("[WiFi_STA] Connecting to %s on channel %u", staConnection.ssid, staConnection.channel);
+
+  // Pinning the access point and channel skips the scan. The address still comes from DHCP, a cached one could clash
+  // with a client the lease was handed to in the meantime
+  WiFi.begin(staConnection.ssid, staProfiles.at(staProfile).psk, staConnection.channel, staConnection.bssid);
+
+  staState      = StaState::Connecting;
+  staUsingCache = true;
+  staDeadline   = millis() + STA_CACHED_CONNECT_TIMEOUT_MS;
+}
+
+void recordResult(bool connected) {
+  if (staProfile == WiFiProfiles::MAX_PROFILES) {
+    return;
+  }
+
+  if (staProfiles.recordResult(staProfile, connected)) {
+    saveProfiles();
+  }
+}
+
+void startConnecting() {
+  staStarted  = millis();
+  staAttempts = 0;
+
+  if (staCached) {
+    connectCached();
+  } else {
+    startScan();
+  }
+}
+
+void handleConnected() {
+  std::uint32_t now = millis();
+  Logger::printlnf("[WiFi_STA] Connected to %s as %s in %u ms (%s), %u ms after boot",
+                   staConnection.ssid,
+                   WiFi.localIP().toString().c_str(),
+                   now - staStarted,
+                   staUsingCache ? "cached" : "scanned",
+                   now);
+
+  staState = StaState::Connected;
+  recordResult(true);
+
+  // Only written when something changed, to spare the SD card a write on every boot. The SSID is the cached one as long
+  // as staCached is set, the bytes behind its terminator are never compared
+  const std::uint8_t* bssid = WiFi.BSSID();
+  std::uint8_t channel      = static_cast<std::uint8_t>(WiFi.channel());
+  if (staCached && std::memcmp(staConnection.bssid, bssid, sizeof(staConnection.bssid)) == 0
+      && staConnection.channel == channel)
+  {
+    return;
+  }
+
+  std::memcpy(staConnection.bssid, bssid, sizeof(staConnection.bssid));
+  staConnection.channel = channel;
+  staCached             = true;
+  saveConnection();
+}
+
+bool WiFi_STA::Start() {
+  std::memset(&staConnection, 0, sizeof(staConnection));
+  staProfilesSaved = millis();
+
+  bool profilesExist  = WiFiProfiles::Exists();
+  staProfilesWritable = !profilesExist || staProfiles.load();
+  if (!staProfilesWritable) {
+    Logger::println("[WiFi_STA] Unable to read network profiles, leaving them untouched");
+  } else if (profilesExist) {
+    Logger::printlnf("[WiFi_STA] Loaded %u network profiles", static_cast<unsigned>(staProfiles.count()));
+  }
+
+  // Without a profile there is no key, the profile may have been removed and the permission to join with it
+  staCached = loadConnection(profilesExist) && staProfiles.find(staConnection.ssid) != WiFiProfiles::MAX_PROFILES;
+  if (!staCached) {
+    Logger::println("[WiFi_STA] No cached connection, scanning");
+  }
+
+  startConnecting();
+
+  return staState != StaState::Waiting;
+}
+
+void WiFi_STA::Stop() {
+  WiFi.disconnect(false);
+  WiFi.scanDelete();
+  staState = StaState::Stopped;
+}
+
+void WiFi_STA::Update() {
+  if (staProfiles.dirty() && staProfilesWritable && millis() - staProfilesSaved >= STA_PROFILES_SAVE_INTERVAL_MS) {
+    saveProfiles();
+  }
+
+  switch (staState) {
+    case StaState::Connecting:
+      break;
+    case StaState::Scanning:
+      {
+        std::int8_t scanResult = WiFi.scanComplete();
+        if (scanResult >= 0) {
+          handleScanResult(scanResult);
+        } else if (scanResult == WIFI_SCAN_FAILED) {
+          Logger::println("[WiFi_STA] Scan failed");
+          waitToRetry();
+        }
+      }
+      return;
+    case StaState::Waiting:
+      if (static_cast<std::int32_t>(millis() - staDeadline) >= 0) {
+        startConnecting();
+      }
+      return;
+    case StaState::Connected:
+      if (!WiFi.isConnected()) {
+        Logger::println("[WiFi_STA] Connection lost, reconnecting");
+        startConnecting();
+      }
+      return;
+    default:
+      return;
+  }
+
+  wl_status_t status = WiFi.status();
+  if (status == WL_CONNECTED) {
+    handleConnected();
+    return;
+  }
+
+  bool failed = status == WL_NO_SSID_AVAIL || status == WL_CONNECT_FAILED || status == WL_WRONG_PASSWORD;
+  if (!failed && static_cast<std::int32_t>(millis() - staDeadline) < 0) {
+    return;
+  }
+
+  Logger::printlnf("[WiFi_STA] Failed to connect to %s (status %u)", staConnection.ssid, status);
+  WiFi.disconnect(false);
+  recordResult(false);
+
+  if (staUsingCache) {
+    // The access point may have moved to another channel, or be gone
+    startScan();
+  } else if (++staAttempts < staProfiles.count()) {
+    // The failure moved this network down the ranking, the next one gets its turn right away
+    startScan();
+  } else {
+    waitToRetry();
+  }
+}
+
+bool WiFi_STA::IsConnected() {
+  return staState == StaState::Connected;
+}
+
+bool WiFi_STA::AddProfile(const char* ssid, const char* psk) {
+  if (!staProfilesWritable) {
+    Logger::println("[WiFi_STA] Network profiles couldn't be read, refusing to overwrite them");
+    return false;
+  }
+
+  if (!staProfiles.add(ssid, psk)) {
+    return false;
+  }
+
+  Logger::printlnf("[WiFi_STA] Added network profile %s", ssid);
+  saveProfiles();
+
+  // Nothing known was in range, the new network may be
+  if (staState == StaState::Waiting) {
+    startConnecting();
+  }
+
+  return true;
+}
+
+bool WiFi_STA::RemoveProfile(const char* ssid) {
+  if (!staProfilesWritable || !staProfiles.remove(ssid)) {
+    return false;
+  }
+
+  Logger::printlnf("[WiFi_STA] Removed network profile %s", ssid);
+  saveProfiles();
+
+  // Indices behind the removed profile moved down. The current connection is kept, but isn't reconnected to
+  staProfile = staProfiles.find(staConnection.ssid);
+  if (staProfile == WiFiProfiles::MAX_PROFILES) {
+    staCached = false;
+  }
+
+  return true;
+}
+
+const WiFiProfiles& WiFi_STA::GetProfiles() {
+  return staProfiles;
+}
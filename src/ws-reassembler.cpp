@@ -0,0 +1,132 @@
+#include "ws-reassembler.hpp"
+
+#include <cstring>
+
+static_assert(WEBSOCKETS_SERVER_CLIENT_MAX <= 32, "Every client needs a bit in _discarding");
+
+WsReassembler::WsReassembler() : _slots(), _discarding(0), _stats() { }
+
+WsReassembler::Result
+  WsReassembler::begin(std::uint8_t clientId, bool binary, const std::uint8_t* data, std::size_t length, std::uint32_t now) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return Result::Dropped;
+  }
+
+  // A new message replaces whatever the client left unfinished
+  drop(clientId);
+
+  if (length > MAX_MESSAGE_SIZE) {
+    _stats.droppedOversize++;
+    _discard(clientId);
+    return Result::Dropped;
+  }
+
+  Slot* slot = nullptr;
+  for (Slot& candidate : _slots) {
+    if (!candidate.inUse) {
+      slot = &candidate;
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    _stats.droppedNoBuffer++;
+    _discard(clientId);
+    return Result::Dropped;
+  }
+
+  slot->inUse        = true;
+  slot->binary       = binary;
+  slot->clientId     = clientId;
+  slot->length       = length;
+  slot->lastFragment = now;
+  std::memcpy(slot->data, data, length);
+
+  return Result::Pending;
+}
+
+WsReassembler::Result WsReassembler::append(std::uint8_t clientId,
+                                            const std::uint8_t* data,
+                                            std::size_t length,
+                                            bool final,
+                                            std::uint32_t now,
+                                            Message& message) {
+  if (clientId >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return Result::Dropped;
+  }
+
+  if ((_discarding & (1UL << clientId)) != 0) {
+    if (final) {
+      _discarding &= ~(1UL << clientId);
+    }
+    return Result::Skipped;
+  }
+
+  Slot* slot = _findSlot(clientId);
+  if (slot == nullptr) {
+    // Continuation without a start, e.g. the start timed out
+    if (!final) {
+      _discard(clientId);
+    }
+    return Result::Dropped;
+  }
+
+  if (slot->length + length > MAX_MESSAGE_SIZE) {
+    _stats.droppedOversize++;
+    slot->inUse = false;
+    if (!final) {
+      _discard(clientId);
+    }
+    return Result::Dropped;
+  }
+
+  std::memcpy(slot->data + slot->length, data, length);
+  slot->length += length;
+  slot->lastFragment = now;
+
+  if (!final) {
+    return Result::Pending;
+  }
+
+  _stats.completed++;
+  message.binary = slot->binary;
+  message.data   = slot->data;
+  message.length = slot->length;
+
+  return Result::Complete;
+}
+
+void WsReassembler::release(std::uint8_t clientId) {
+  Slot* slot = _findSlot(clientId);
+  if (slot != nullptr) {
+    slot->inUse = false;
+  }
+}
+
+void WsReassembler::drop(std::uint8_t clientId) {
+  release(clientId);
+  if (clientId < WEBSOCKETS_SERVER_CLIENT_MAX) {
+    _discarding &= ~(1UL << clientId);
+  }
+}
+
+void WsReassembler::expire(std::uint32_t now) {
+  for (Slot& slot : _slots) {
+    if (slot.inUse && now - slot.lastFragment > TIMEOUT_MS) {
+      _stats.droppedTimeout++;
+      slot.inUse = false;
+    }
+  }
+}
+
+WsReassembler::Slot* WsReassembler::_findSlot(std::uint8_t clientId) {
+  for (Slot& slot : _slots) {
+    if (slot.inUse && slot.clientId == clientId) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+void WsReassembler::_discard(std::uint8_t clientId) {
+  _discarding |= (1UL << clientId);
+}
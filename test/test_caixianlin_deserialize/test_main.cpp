@@ -0,0 +1,212 @@
+#include "rf-pulse-train.hpp"
+#include "serializers/caixianlin-deserialize.hpp"
+#include "serializers/caixianlin-serialize.hpp"
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+
+constexpr std::uint32_t RANDOM_FRAMES = 1'000'000;
+
+// xorshift32, every run sees the same frames
+std::uint32_t s_random = 1;
+
+std::uint32_t nextRandom() {
+  s_random ^= s_random << 13;
+  s_random ^= s_random >> 17;
+  s_random ^= s_random << 5;
+  return s_random;
+}
+
+CaiXianlinMessage randomMessage() {
+  std::uint32_t value = nextRandom();
+  return {static_cast<std::uint16_t>(value),
+          static_cast<Channel>((value >> 16) % 3),
+          static_cast<Command>(1 + (value >> 18) % 3),
+          static_cast<std::uint8_t>((value >> 20) % 100)};
+}
+
+std::array<std::byte, CAIXIANLIN_FRAME_SIZE> encode(const CaiXianlinMessage& message) {
+  return MakeCaiXianlinFrame(message.transmitterId, message.channel, message.command, message.strength);
+}
+
+bool sameMessage(const CaiXianlinMessage& a, const CaiXianlinMessage& b) {
+  return a.transmitterId == b.transmitterId && a.channel == b.channel && a.command == b.command && a.strength == b.strength;
+}
+
+// Pulse widths of the frame as the receiver would capture them, every width moved by up to jitterUs either way.
+// Returns the number of pulses, 0 if the frame can't be transmitted
+std::size_t capture(const std::array<std::byte, CAIXIANLIN_FRAME_SIZE>& frame,
+                    std::uint16_t chipUs,
+                    std::uint16_t jitterUs,
+                    std::uint16_t* durations) {
+  RfPulseTrain train;
+  if (!train.build(frame.data(), frame.size(), chipUs)) {
+    return 0;
+  }
+
+  for (std::size_t i = 0; i < train.count(); ++i) {
+    std::int32_t offset = jitterUs > 0 ? static_cast<std::int32_t>(nextRandom() % (2 * jitterUs + 1)) - jitterUs : 0;
+    durations[i]        = static_cast<std::uint16_t>(train.durationUs(i) + offset);
+  }
+  return train.count();
+}
+
+void setUp() {
+  s_random = 1;
+}
+void tearDown() { }
+
+void test_random_frames_round_trip() {
+  for (std::uint32_t i = 0; i < RANDOM_FRAMES; ++i) {
+    CaiXianlinMessage expected = randomMessage();
+    CaiXianlinMessage actual {};
+    std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = encode(expected);
+
+    if (ParseMessage(frame, actual) != CaiXianlinParseResult::Ok || !sameMessage(expected, actual)) {
+      char message[64];
+      std::snprintf(message, sizeof(message), "Frame %u didn't round trip", static_cast<unsigned>(i));
+      TEST_FAIL_MESSAGE(message);
+    }
+  }
+}
+
+void test_every_strength_round_trips() {
+  for (std::uint8_t strength = 0; strength <= 99; ++strength) {
+    TEST_ASSERT_TRUE(CaiXianlinRoundTrips(0xA5C3, Channel::Channel3, Command::Shock, strength));
+  }
+}
+
+void test_rejects_broken_framing() {
+  CaiXianlinMessage message {};
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = encode({0x1234, Channel::Channel2, Command::Vibrate, 50});
+
+  frame[0] = std::byte {0xF8};
+  TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::BadFraming, ParseMessage(frame, message));
+
+  frame                            = encode({0x1234, Channel::Channel2, Command::Vibrate, 50});
+  frame[CAIXIANLIN_FRAME_SIZE - 1] = std::byte {0x8E};
+  TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::BadFraming, ParseMessage(frame, message));
+}
+
+void test_rejects_every_invalid_symbol() {
+  CaiXianlinMessage message {};
+  for (std::size_t position = 1; position < CAIXIANLIN_FRAME_SIZE - 1; ++position) {
+    for (int symbol = 0; symbol <= UINT8_MAX; ++symbol) {
+      if (CAIXIANLIN_SYMBOL_BITS[symbol] != CAIXIANLIN_INVALID_SYMBOL) {
+        continue;
+      }
+
+      std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = encode({0x1234, Channel::Channel2, Command::Vibrate, 50});
+      frame[position]                                    = static_cast<std::byte>(symbol);
+      TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::BadSymbol, ParseMessage(frame, message));
+    }
+  }
+}
+
+void test_rejects_checksum_mismatch() {
+  CaiXianlinMessage message {};
+
+  // Any other valid symbol in a field changes the value without fixing the checksum
+  for (std::size_t position = 1; position < CAIXIANLIN_FRAME_SIZE - 1; ++position) {
+    std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = encode({0x1234, Channel::Channel2, Command::Vibrate, 50});
+    std::uint8_t bits                                  = CAIXIANLIN_SYMBOL_BITS[static_cast<std::uint8_t>(frame[position])];
+    frame[position]                                    = CAIXIANLIN_SYMBOLS[(bits + 1) & 3];
+
+    CaiXianlinParseResult result = ParseMessage(frame, message);
+    TEST_ASSERT_TRUE(result == CaiXianlinParseResult::BadChecksum || result == CaiXianlinParseResult::InvalidValue);
+  }
+}
+
+void test_rejects_out_of_range_fields() {
+  // Channel 3 with a checksum that matches it
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = encode({0x1234, Channel::Channel3, Command::Vibrate, 50});
+  frame[10]                                          = CAIXIANLIN_SYMBOLS[3];
+  EncodeCaiXianlinByte(frame.data() + CAIXIANLIN_CHECKSUM_AT, Checksum8(0x1234) + 3 + 2 + 50);
+
+  CaiXianlinMessage message {};
+  TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::InvalidValue, ParseMessage(frame, message));
+}
+
+void test_captures_tolerate_jitter() {
+  std::uint16_t durations[RfPulseTrain::MAX_PULSES];
+
+  for (int i = 0; i < 10'000; ++i) {
+    CaiXianlinMessage expected = randomMessage();
+    CaiXianlinMessage actual {};
+
+    std::size_t count = capture(encode(expected), 250, 75, durations);
+    TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::Ok, ParseCaiXianlinPulses(durations, count, actual, 250));
+    TEST_ASSERT_TRUE(sameMessage(expected, actual));
+  }
+}
+
+void test_captures_measure_chip_from_sync() {
+  std::uint16_t durations[RfPulseTrain::MAX_PULSES];
+
+  // A remote running 10% slow, with a little jitter on top
+  for (int i = 0; i < 10'000; ++i) {
+    CaiXianlinMessage expected = randomMessage();
+    CaiXianlinMessage actual {};
+
+    std::size_t count = capture(encode(expected), 275, 20, durations);
+    TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::Ok, ParseCaiXianlinPulses(durations, count, actual));
+    TEST_ASSERT_TRUE(sameMessage(expected, actual));
+  }
+}
+
+void test_captures_reject_bad_timing() {
+  std::uint16_t durations[RfPulseTrain::MAX_PULSES];
+  CaiXianlinMessage message {};
+
+  std::size_t count = capture(encode({0x1234, Channel::Channel2, Command::Vibrate, 50}), 250, 0, durations);
+  durations[3] += 125;  // Half a chip, neither one nor two chips long
+  TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::BadTiming, ParseCaiXianlinPulses(durations, count, message, 250));
+
+  TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::BadTiming, ParseCaiXianlinPulses(durations, 20, message, 250));
+  TEST_ASSERT_EQUAL_UINT8(CaiXianlinParseResult::BadTiming, ParseCaiXianlinPulses(durations, 0, message, 250));
+}
+
+void test_benchmark() {
+  constexpr std::size_t FRAMES = 1024;
+
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frames[FRAMES];
+  for (auto& frame : frames) {
+    frame = encode(randomMessage());
+  }
+
+  std::uint32_t sink = 0;
+  auto start         = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < RANDOM_FRAMES * 4; ++i) {
+    CaiXianlinMessage message {};
+    if (ParseMessage(frames[i % FRAMES], message) == CaiXianlinParseResult::Ok) {
+      sink += message.strength;
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Keeps the loop from being optimized away
+  volatile std::uint32_t result = sink;
+  (void)result;
+
+  double ns = std::chrono::duration<double, std::nano>(elapsed).count() / (RANDOM_FRAMES * 4);
+  char message[64];
+  std::snprintf(message, sizeof(message), "Decoding %.1f ns/frame, %.1f M frames/s", ns, 1000.0 / ns);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_random_frames_round_trip);
+  RUN_TEST(test_every_strength_round_trips);
+  RUN_TEST(test_rejects_broken_framing);
+  RUN_TEST(test_rejects_every_invalid_symbol);
+  RUN_TEST(test_rejects_checksum_mismatch);
+  RUN_TEST(test_rejects_out_of_range_fields);
+  RUN_TEST(test_captures_tolerate_jitter);
+  RUN_TEST(test_captures_measure_chip_from_sync);
+  RUN_TEST(test_captures_reject_bad_timing);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#include "serializers/caixianlin-serialize.hpp"
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// The bit-by-bit encoder the lookup tables replaced, kept as the reference they are checked against
+template<std::size_t N, typename T>
+void ReferenceFillEncodedBits(nonstd::span<std::byte, N> buffer,
+                              std::size_t bufferOffset,
+                              T value,
+                              std::size_t valueOffset = 0) {
+  std::int64_t valueBits  = (sizeof(T) * 8) - valueOffset;
+  std::int64_t bufferSize = N - bufferOffset;
+
+  if (valueBits <= 0 || bufferSize <= 0 || (bufferSize * 2) < valueBits) {
+    return;
+  }
+
+  std::size_t bufferLastIndex = bufferOffset + (valueBits / 2) - 1;
+  if (valueOffset & 1) {
+    buffer[bufferLastIndex--] = static_cast<std::byte>(0x80 | ((value & 1) * 0x60));
+    value >>= 1;
+  }
+
+  while (bufferLastIndex >= bufferOffset) {
+    buffer[bufferLastIndex--] = static_cast<std::byte>(0x88 | ((value & 2) * 0x30) | ((value & 1) * 0x06));
+    value >>= 2;
+  }
+}
+
+bool ReferenceCreateMessage(std::uint16_t transmitterId,
+                            Channel channel,
+                            Command command,
+                            std::uint8_t strength,
+                            nonstd::span<std::byte, CAIXIANLIN_FRAME_SIZE> message) {
+  if (channel < Channel::_Min || channel > Channel::_Max || command < Command::_Min || command > Command::_Max || strength > 99)
+  {
+    return false;
+  }
+
+  std::uint8_t channelValue = static_cast<std::uint8_t>(channel);
+  std::uint8_t commandValue = static_cast<std::uint8_t>(command);
+
+  std::uint8_t checksum = Checksum8(transmitterId) + channelValue + commandValue + strength;
+
+  message[0] = std::byte {0xFC};
+  ReferenceFillEncodedBits(message, 1, transmitterId);
+  ReferenceFillEncodedBits(message, 9, channelValue, 4);
+  ReferenceFillEncodedBits(message, 11, commandValue, 4);
+  ReferenceFillEncodedBits(message, 13, strength);
+  ReferenceFillEncodedBits(message, 17, checksum);
+  message[21] = std::byte {0x88};
+
+  return true;
+}
+
+// Encodes with both and compares the results, the frames start out different so an untouched frame is noticed too
+bool MatchesReference(std::uint16_t transmitterId, Channel channel, Command command, std::uint8_t strength) {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> expected;
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> actual;
+  expected.fill(std::byte {0x00});
+  actual.fill(std::byte {0x00});
+
+  bool expectedOk = ReferenceCreateMessage(transmitterId, channel, command, strength, expected);
+  bool actualOk   = CreateMessage(transmitterId, channel, command, strength, actual);
+
+  return expectedOk == actualOk && expected == actual;
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_reference_frame() {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = MakeCaiXianlinFrame(0x1234, Channel::Channel2, Command::Vibrate, 50);
+  TEST_ASSERT_EQUAL_MEMORY(CAIXIANLIN_REFERENCE_FRAME, frame.data(), CAIXIANLIN_FRAME_SIZE);
+}
+
+void test_every_transmitter_id_matches_reference() {
+  for (std::uint32_t id = 0; id <= UINT16_MAX; ++id) {
+    Channel channel = static_cast<Channel>(id % 3);
+    Command command = static_cast<Command>(1 + id % 3);
+    if (!MatchesReference(static_cast<std::uint16_t>(id), channel, command, static_cast<std::uint8_t>(id % 100))) {
+      char message[48];
+      std::snprintf(message, sizeof(message), "Mismatch for transmitter ID 0x%04X", static_cast<unsigned>(id));
+      TEST_FAIL_MESSAGE(message);
+    }
+  }
+}
+
+void test_every_field_combination_matches_reference() {
+  constexpr std::uint16_t ids[] = {0x0000, 0x00FF, 0x1234, 0x8001, 0xFFFF};
+
+  for (std::uint16_t id : ids) {
+    for (int channel = -1; channel <= 3; ++channel) {
+      for (int command = 0; command <= 4; ++command) {
+        for (int strength = 0; strength <= UINT8_MAX; ++strength) {
+          Channel channelValue = static_cast<Channel>(channel);
+          Command commandValue = static_cast<Command>(command);
+          TEST_ASSERT_TRUE(MatchesReference(id, channelValue, commandValue, static_cast<std::uint8_t>(strength)));
+        }
+      }
+    }
+  }
+}
+
+void test_out_of_range_leaves_frame_untouched() {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame;
+  frame.fill(std::byte {0x55});
+
+  TEST_ASSERT_FALSE(CreateMessage(0x1234, Channel::Channel1, Command::Shock, 100, frame));
+  TEST_ASSERT_FALSE(CreateMessage(0x1234, static_cast<Channel>(3), Command::Shock, 0, frame));
+  TEST_ASSERT_FALSE(CreateMessage(0x1234, Channel::Channel1, static_cast<Command>(0), 0, frame));
+  for (std::byte symbol : frame) {
+    TEST_ASSERT_EQUAL_UINT8(0x55, static_cast<std::uint8_t>(symbol));
+  }
+}
+
+template<typename Encoder>
+double MeasureNsPerMessage(Encoder encode) {
+  constexpr std::uint32_t MESSAGES = 2'000'000;
+
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame {};
+  std::uint32_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < MESSAGES; ++i) {
+    encode(static_cast<std::uint16_t>(i * 40503), static_cast<std::uint8_t>(i % 100), frame);
+    sink += static_cast<std::uint8_t>(frame[CAIXIANLIN_CHECKSUM_AT + 3]);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Keeps the loop from being optimized away
+  volatile std::uint32_t result = sink;
+  (void)result;
+
+  return std::chrono::duration<double, std::nano>(elapsed).count() / MESSAGES;
+}
+
+void test_benchmark() {
+  double reference = MeasureNsPerMessage([](std::uint16_t id, std::uint8_t strength, auto& frame) {
+    ReferenceCreateMessage(id, Channel::Channel2, Command::Vibrate, strength, frame);
+  });
+  double table = MeasureNsPerMessage([](std::uint16_t id, std::uint8_t strength, auto& frame) {
+    CreateMessage(id, Channel::Channel2, Command::Vibrate, strength, frame);
+  });
+
+  char message[96];
+  std::snprintf(message, sizeof(message), "Bit-by-bit %.1f ns/message, lookup table %.1f ns/message", reference, table);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reference_frame);
+  RUN_TEST(test_every_transmitter_id_matches_reference);
+  RUN_TEST(test_every_field_combination_matches_reference);
+  RUN_TEST(test_out_of_range_leaves_frame_untouched);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
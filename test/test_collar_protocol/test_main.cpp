@@ -0,0 +1,161 @@
+#include "rf-pulse-train.hpp"
+#include "serializers/caixianlin-protocol.hpp"
+#include "serializers/collar-protocol.hpp"
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+
+// Every protocol policy runs through the same suite, a new brand only has to be added to main()
+template<typename Policy>
+struct ProtocolSuite {
+  using Protocol = CollarProtocol<Policy>;
+  using Frame    = typename Protocol::Frame;
+
+  static constexpr std::uint32_t RANDOM_FRAMES = 1'000'000;
+
+  // xorshift32, every run sees the same frames
+  static std::uint32_t nextRandom() {
+    static std::uint32_t random = 1;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return random;
+  }
+
+  static CollarFrameFields randomFields() {
+    std::uint32_t value = nextRandom();
+    return {static_cast<std::uint16_t>(value),
+            static_cast<Channel>((value >> 16) % 3),
+            static_cast<Command>(1 + (value >> 18) % 3),
+            static_cast<std::uint8_t>((value >> 20) % (Protocol::MAX_STRENGTH + 1))};
+  }
+
+  static void test_random_frames_round_trip() {
+    for (std::uint32_t i = 0; i < RANDOM_FRAMES; ++i) {
+      CollarFrameFields expected = randomFields();
+      CollarFrameFields actual {};
+      Frame frame {};
+
+      if (!Protocol::Encode(expected, frame) || !Protocol::Decode(frame, actual) || !Protocol::Equals(expected, actual)) {
+        char message[64];
+        std::snprintf(message, sizeof(message), "%s frame %u didn't round trip", Protocol::NAME, static_cast<unsigned>(i));
+        TEST_FAIL_MESSAGE(message);
+      }
+    }
+  }
+
+  static void test_patched_strength_matches_encode() {
+    for (int i = 0; i < 1000; ++i) {
+      CollarFrameFields fields = randomFields();
+      Frame patched            = Protocol::Make(fields);
+
+      for (int strength = 0; strength <= Protocol::MAX_STRENGTH; ++strength) {
+        fields.strength = static_cast<std::uint8_t>(strength);
+        Protocol::PatchStrength(patched, fields);
+        TEST_ASSERT_TRUE(patched == Protocol::Make(fields));
+      }
+    }
+  }
+
+  static void test_out_of_range_leaves_frame_untouched() {
+    const CollarFrameFields invalid[] = {
+      {0x1234, Channel::Channel1, Command::Shock, static_cast<std::uint8_t>(Protocol::MAX_STRENGTH + 1)},
+      {0x1234, static_cast<Channel>(3), Command::Shock, 0},
+      {0x1234, Channel::Channel1, static_cast<Command>(0), 0},
+    };
+
+    for (const CollarFrameFields& fields : invalid) {
+      Frame frame;
+      frame.fill(std::byte {0x55});
+      TEST_ASSERT_FALSE(Protocol::Encode(fields, frame));
+      for (std::byte symbol : frame) {
+        TEST_ASSERT_EQUAL_UINT8(0x55, static_cast<std::uint8_t>(symbol));
+      }
+    }
+  }
+
+  static void test_single_bit_errors_are_rejected() {
+    for (int i = 0; i < 1000; ++i) {
+      Frame frame = Protocol::Make(randomFields());
+
+      for (std::size_t bit = 0; bit < Protocol::FRAME_SIZE * 8; ++bit) {
+        Frame corrupted = frame;
+        corrupted[bit / 8] ^= static_cast<std::byte>(0x80 >> (bit % 8));
+
+        CollarFrameFields fields {};
+        TEST_ASSERT_FALSE(Protocol::Decode(corrupted, fields));
+      }
+    }
+  }
+
+  static void test_frames_fit_the_transmitter() {
+    for (int i = 0; i < 1000; ++i) {
+      Frame frame = Protocol::Make(randomFields());
+
+      RfPulseTrain train;
+      TEST_ASSERT_TRUE(train.build(frame.data(), frame.size(), Protocol::CHIP_US));
+      TEST_ASSERT_EQUAL_UINT32(Protocol::FRAME_US, train.totalUs());
+    }
+  }
+
+  template<typename Operation>
+  static double measureNsPerFrame(Operation operation) {
+    constexpr std::size_t FRAMES = 1024;
+
+    CollarFrameFields fields[FRAMES];
+    Frame frames[FRAMES];
+    for (std::size_t i = 0; i < FRAMES; ++i) {
+      fields[i] = randomFields();
+      frames[i] = Protocol::Make(fields[i]);
+    }
+
+    std::uint32_t sink = 0;
+    auto start         = std::chrono::steady_clock::now();
+    for (std::uint32_t i = 0; i < RANDOM_FRAMES * 2; ++i) {
+      sink += operation(fields[i % FRAMES], frames[i % FRAMES]);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Keeps the loop from being optimized away
+    volatile std::uint32_t result = sink;
+    (void)result;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (RANDOM_FRAMES * 2);
+  }
+
+  static void test_benchmark() {
+    double encode = measureNsPerFrame([](const CollarFrameFields& fields, Frame& frame) {
+      Protocol::Encode(fields, frame);
+      return static_cast<std::uint32_t>(frame[Protocol::FRAME_SIZE / 2]);
+    });
+    double decode = measureNsPerFrame([](const CollarFrameFields&, Frame& frame) {
+      CollarFrameFields decoded {};
+      return Protocol::Decode(frame, decoded) ? decoded.strength : 0U;
+    });
+
+    char message[96];
+    std::snprintf(message, sizeof(message), "%s: encode %.1f ns/frame, decode %.1f ns/frame", Protocol::NAME, encode, decode);
+    TEST_MESSAGE(message);
+  }
+
+  static void run() {
+    TEST_MESSAGE(Protocol::NAME);
+    RUN_TEST(test_random_frames_round_trip);
+    RUN_TEST(test_patched_strength_matches_encode);
+    RUN_TEST(test_out_of_range_leaves_frame_untouched);
+    RUN_TEST(test_single_bit_errors_are_rejected);
+    RUN_TEST(test_frames_fit_the_transmitter);
+    RUN_TEST(test_benchmark);
+  }
+};
+
+void setUp() { }
+void tearDown() { }
+
+int main() {
+  UNITY_BEGIN();
+  ProtocolSuite<CaiXianlinProtocol>::run();
+  return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include "http-range.hpp"
+
+#include <unity.h>
+
+using ParseResult = HttpRangeSet::ParseResult;
+
+constexpr std::size_t FILE_SIZE = 1000;
+
+void AssertRange(const HttpRangeSet& ranges, std::size_t index, std::size_t start, std::size_t length) {
+  TEST_ASSERT_TRUE(index < ranges.count());
+  TEST_ASSERT_EQUAL_UINT32(start, ranges[index].start);
+  TEST_ASSERT_EQUAL_UINT32(length, ranges[index].length);
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_single_ranges() {
+  HttpRangeSet ranges;
+
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-499", FILE_SIZE) == ParseResult::Satisfiable);
+  TEST_ASSERT_EQUAL_UINT32(1, ranges.count());
+  AssertRange(ranges, 0, 0, 500);
+  TEST_ASSERT_EQUAL_UINT32(499, ranges[0].last());
+
+  // Open-ended and suffix ranges
+  TEST_ASSERT_TRUE(ranges.parse("bytes=900-", FILE_SIZE) == ParseResult::Satisfiable);
+  AssertRange(ranges, 0, 900, 100);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=-100", FILE_SIZE) == ParseResult::Satisfiable);
+  AssertRange(ranges, 0, 900, 100);
+
+  // Ranges reaching past the end are clamped to the file
+  TEST_ASSERT_TRUE(ranges.parse("bytes=990-2000", FILE_SIZE) == ParseResult::Satisfiable);
+  AssertRange(ranges, 0, 990, 10);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=-5000", FILE_SIZE) == ParseResult::Satisfiable);
+  AssertRange(ranges, 0, 0, FILE_SIZE);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=999-999", FILE_SIZE) == ParseResult::Satisfiable);
+  AssertRange(ranges, 0, 999, 1);
+}
+
+void test_multiple_ranges() {
+  HttpRangeSet ranges;
+
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-9, 20-29 ,\t-10", FILE_SIZE) == ParseResult::Satisfiable);
+  TEST_ASSERT_EQUAL_UINT32(3, ranges.count());
+  AssertRange(ranges, 0, 0, 10);
+  AssertRange(ranges, 1, 20, 10);
+  AssertRange(ranges, 2, 990, 10);
+
+  // Ranges outside the file are dropped, the rest are kept
+  TEST_ASSERT_TRUE(ranges.parse("bytes=5000-6000,10-19", FILE_SIZE) == ParseResult::Satisfiable);
+  TEST_ASSERT_EQUAL_UINT32(1, ranges.count());
+  AssertRange(ranges, 0, 10, 10);
+
+  std::size_t count = 0;
+  for (const HttpRange& range : ranges) {
+    TEST_ASSERT_EQUAL_UINT32(10, range.start);
+    count++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, count);
+}
+
+void test_unsatisfiable_ranges() {
+  HttpRangeSet ranges;
+
+  TEST_ASSERT_TRUE(ranges.parse("bytes=1000-", FILE_SIZE) == ParseResult::Unsatisfiable);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=1000-1999,5000-", FILE_SIZE) == ParseResult::Unsatisfiable);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=-0", FILE_SIZE) == ParseResult::Unsatisfiable);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-", 0) == ParseResult::Unsatisfiable);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=-10", 0) == ParseResult::Unsatisfiable);
+  TEST_ASSERT_EQUAL_UINT32(0, ranges.count());
+}
+
+void test_malformed_headers_serve_the_full_file() {
+  constexpr const char* malformed[] = {
+    "",
+    "bytes=",
+    "bytes=-",
+    "bytes=abc",
+    "bytes=10",
+    "bytes=10-5",
+    "bytes=0-9,",
+    "bytes=0-9;10-19",
+    "bytes=0-9 x",
+    "items=0-9",
+    "Bytes=0-9",
+    "bytes=46116860184273879040-",
+    "bytes=0-99999999999999999999999",
+  };
+
+  HttpRangeSet ranges;
+  TEST_ASSERT_TRUE(ranges.parse(nullptr, FILE_SIZE) == ParseResult::None);
+  for (const char* header : malformed) {
+    TEST_ASSERT_TRUE_MESSAGE(ranges.parse(header, FILE_SIZE) == ParseResult::None, header);
+    TEST_ASSERT_EQUAL_UINT32(0, ranges.count());
+  }
+}
+
+void test_range_count_is_capped() {
+  HttpRangeSet ranges;
+
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-0,1-1,2-2,3-3,4-4,5-5,6-6,7-7", FILE_SIZE) == ParseResult::Satisfiable);
+  TEST_ASSERT_EQUAL_UINT32(HttpRangeSet::MAX_RANGES, ranges.count());
+
+  // One range too many rejects the whole header, so a client can't make the response arbitrarily fragmented
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-0,1-1,2-2,3-3,4-4,5-5,6-6,7-7,8-8", FILE_SIZE) == ParseResult::None);
+  TEST_ASSERT_EQUAL_UINT32(0, ranges.count());
+
+  // Dropped ranges don't count against the cap
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-0,1-1,2-2,3-3,4-4,5-5,6-6,7-7,2000-", FILE_SIZE) == ParseResult::Satisfiable);
+  TEST_ASSERT_EQUAL_UINT32(HttpRangeSet::MAX_RANGES, ranges.count());
+}
+
+void test_parse_resets_previous_ranges() {
+  HttpRangeSet ranges;
+
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-9,20-29", FILE_SIZE) == ParseResult::Satisfiable);
+  TEST_ASSERT_TRUE(ranges.parse("bytes=0-9,x", FILE_SIZE) == ParseResult::None);
+  TEST_ASSERT_EQUAL_UINT32(0, ranges.count());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_ranges);
+  RUN_TEST(test_multiple_ranges);
+  RUN_TEST(test_unsatisfiable_ranges);
+  RUN_TEST(test_malformed_headers_serve_the_full_file);
+  RUN_TEST(test_range_count_is_capped);
+  RUN_TEST(test_parse_resets_previous_ranges);
+  return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#include "json-command-parser.hpp"
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using Status = WsProtocol::Status;
+
+Status Parse(const char* json, WsProtocol::Message& message) {
+  return JsonCommandParser::Parse(json, std::strlen(json), message);
+}
+
+Status Parse(const char* json) {
+  WsProtocol::Message message {};
+  return Parse(json, message);
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_command_fields() {
+  WsProtocol::Message message {};
+
+  TEST_ASSERT_TRUE(Parse(" {\"op\":\"cmd\", \"seq\":7, \"id\":4660, \"ch\":2, \"cmd\":\"vibrate\", \"str\":99, \"dur\":1000}\n",
+                         message)
+                   == Status::Ok);
+  TEST_ASSERT_TRUE(message.opcode == WsProtocol::Opcode::Command);
+  TEST_ASSERT_EQUAL_UINT16(7, message.sequence);
+  TEST_ASSERT_TRUE(message.command.action == CollarAction::Transmit);
+  TEST_ASSERT_EQUAL_UINT16(4660, message.command.transmitterId);
+  TEST_ASSERT_TRUE(message.command.channel == Channel::Channel3);
+  TEST_ASSERT_TRUE(message.command.command == Command::Vibrate);
+  TEST_ASSERT_EQUAL_UINT8(99, message.command.strength);
+  TEST_ASSERT_EQUAL_UINT16(1000, message.command.durationMs);
+
+  // The command may also be given by number, the duration is optional
+  TEST_ASSERT_TRUE(Parse("{\"cmd\":3,\"str\":0,\"ch\":0,\"id\":65535,\"op\":\"cmd\"}", message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.command.command == Command::Beep);
+  TEST_ASSERT_EQUAL_UINT16(65535, message.command.transmitterId);
+  TEST_ASSERT_EQUAL_UINT16(0, message.command.durationMs);
+}
+
+void test_stop_and_subscription() {
+  WsProtocol::Message message {};
+
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"stop\",\"seq\":2,\"id\":4660,\"ch\":1}", message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.opcode == WsProtocol::Opcode::Stop);
+  TEST_ASSERT_TRUE(message.command.action == CollarAction::Stop);
+  TEST_ASSERT_TRUE(message.command.channel == Channel::Channel2);
+
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":3}", message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.opcode == WsProtocol::Opcode::Subscribe);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"unsub\"}", message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.opcode == WsProtocol::Opcode::Unsubscribe);
+
+  // Fields that belong to another op
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"stop\",\"id\":4660,\"ch\":1,\"str\":5}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"id\":4660}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"cmd\",\"id\":4660,\"ch\":1,\"cmd\":\"beep\"}") == Status::Malformed);
+}
+
+void test_unknown_fields_are_rejected() {
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"cmd\",\"id\":1,\"ch\":0,\"cmd\":1,\"str\":5,\"x\":1}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"x\":1,\"op\":\"sub\"}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"OP\":\"sub\"}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"op\":\"sub\"}") == Status::Malformed);
+
+  // Nested values, other JSON types and unknown enum values
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":{}}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":[1]}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":true}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":-1}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":1.5}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"jump\"}") == Status::InvalidCommand);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"cmd\",\"id\":1,\"ch\":0,\"cmd\":\"zap\",\"str\":5}") == Status::InvalidCommand);
+
+  // Anything that isn't a single, complete object
+  TEST_ASSERT_TRUE(Parse("") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\"") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\"} {}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"seq\":1}") == Status::Malformed);
+}
+
+void test_oversize_fields_are_rejected() {
+  // Keys and strings longer than their buffers, and escapes the parser doesn't decode
+  TEST_ASSERT_TRUE(Parse("{\"sequencenumber\":1,\"op\":\"sub\"}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\"}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"s\\u0075b\"}") == Status::Malformed);
+
+  // Numbers above the field's range, even ones that would wrap a 32-bit value
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":65536}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"seq\":4294967297}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"cmd\",\"id\":1,\"ch\":3,\"cmd\":1,\"str\":5}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"cmd\",\"id\":1,\"ch\":0,\"cmd\":1,\"str\":100}") == Status::Malformed);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"cmd\",\"id\":1,\"ch\":0,\"cmd\":0,\"str\":5}") == Status::InvalidCommand);
+
+  // Whole messages over the limit are rejected before they are read
+  char message[JsonCommandParser::MAX_MESSAGE_SIZE + 2];
+  std::size_t length = std::snprintf(message, sizeof(message), "{\"op\":\"sub\"}");
+  std::memset(message + length, ' ', sizeof(message) - length - 1);
+  message[sizeof(message) - 1] = '\0';
+
+  WsProtocol::Message parsed {};
+  TEST_ASSERT_TRUE(JsonCommandParser::Parse(message, JsonCommandParser::MAX_MESSAGE_SIZE, parsed) == Status::Ok);
+  TEST_ASSERT_TRUE(JsonCommandParser::Parse(message, JsonCommandParser::MAX_MESSAGE_SIZE + 1, parsed) == Status::Malformed);
+}
+
+void test_version_check() {
+  WsProtocol::Message message {};
+
+  TEST_ASSERT_TRUE(Parse("{\"v\":1,\"op\":\"sub\"}") == Status::Ok);
+  TEST_ASSERT_TRUE(Parse("{\"op\":\"sub\",\"v\":1}") == Status::Ok);
+
+  TEST_ASSERT_TRUE(Parse("{\"seq\":9,\"v\":2,\"op\":\"sub\"}", message) == Status::UnsupportedVersion);
+  TEST_ASSERT_EQUAL_UINT16(9, message.sequence);
+  TEST_ASSERT_TRUE(Parse("{\"v\":0,\"op\":\"sub\"}") == Status::UnsupportedVersion);
+  TEST_ASSERT_TRUE(Parse("{\"v\":10,\"op\":\"sub\"}") == Status::UnsupportedVersion);
+  TEST_ASSERT_TRUE(Parse("{\"v\":1.1,\"op\":\"sub\"}") == Status::UnsupportedVersion);
+  TEST_ASSERT_TRUE(Parse("{\"v\":\"1\",\"op\":\"sub\"}") == Status::UnsupportedVersion);
+  TEST_ASSERT_TRUE(Parse("{\"v\":\"two\",\"op\":\"sub\"}") == Status::UnsupportedVersion);
+  TEST_ASSERT_TRUE(Parse("{\"v\":null,\"op\":\"sub\"}") == Status::UnsupportedVersion);
+}
+
+void test_ack_encoding() {
+  char ack[JsonCommandParser::MAX_ACK_SIZE];
+
+  std::size_t length = JsonCommandParser::EncodeAck(65535, Status::UnsupportedVersion, ack, sizeof(ack));
+  TEST_ASSERT_EQUAL_STRING("{\"ack\":65535,\"status\":2}", ack);
+  TEST_ASSERT_EQUAL_UINT32(std::strlen(ack), length);
+
+  // Nothing is sent rather than a truncated ack
+  TEST_ASSERT_EQUAL_UINT32(0, JsonCommandParser::EncodeAck(1, Status::Ok, ack, 8));
+}
+
+void test_benchmark() {
+  constexpr std::uint32_t MESSAGES = 1'000'000;
+  constexpr const char* json       = "{\"op\":\"cmd\",\"seq\":7,\"id\":4660,\"ch\":1,\"cmd\":\"shock\",\"str\":50,"
+                                     "\"dur\":1000}";
+
+  std::size_t length = std::strlen(json);
+  std::uint32_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < MESSAGES; ++i) {
+    WsProtocol::Message message {};
+    sink += static_cast<std::uint32_t>(JsonCommandParser::Parse(json, length, message)) + message.command.strength;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Keeps the loop from being optimized away
+  volatile std::uint32_t result = sink;
+  (void)result;
+
+  char message[64];
+  std::snprintf(message, sizeof(message), "Command parse %.1f ns/message",
+                std::chrono::duration<double, std::nano>(elapsed).count() / MESSAGES);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_command_fields);
+  RUN_TEST(test_stop_and_subscription);
+  RUN_TEST(test_unknown_fields_are_rejected);
+  RUN_TEST(test_oversize_fields_are_rejected);
+  RUN_TEST(test_version_check);
+  RUN_TEST(test_ack_encoding);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
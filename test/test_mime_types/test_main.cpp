@@ -0,0 +1,58 @@
+#include "mime-types.hpp"
+
+#include <unity.h>
+
+#include <cstdio>
+#include <cstring>
+
+void setUp() { }
+void tearDown() { }
+
+void test_every_entry_is_found() {
+  char dotted[MIME_EXTENSION_MAX_LEN + 2];
+
+  for (const MimeTypeEntry& entry : MIME_TYPES) {
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(entry.mimeType, MimeTypes::Find(entry.extension), entry.extension);
+
+    std::snprintf(dotted, sizeof(dotted), ".%s", entry.extension);
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(entry.mimeType, MimeTypes::Find(dotted), dotted);
+  }
+}
+
+void test_lookup_ignores_case() {
+  char upper[MIME_EXTENSION_MAX_LEN + 1];
+  char mixed[MIME_EXTENSION_MAX_LEN + 1];
+
+  for (const MimeTypeEntry& entry : MIME_TYPES) {
+    std::size_t length = std::strlen(entry.extension);
+    for (std::size_t i = 0; i <= length; ++i) {
+      char c   = entry.extension[i];
+      upper[i] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - ('a' - 'A')) : c;
+      mixed[i] = (i & 1) ? upper[i] : c;
+    }
+
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(entry.mimeType, MimeTypes::Find(upper), upper);
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(entry.mimeType, MimeTypes::Find(mixed), mixed);
+  }
+}
+
+void test_unknown_extensions_miss() {
+  constexpr const char* unknown[] = {"exe", ".exe", "htmlx", "htm.", "j", "s", "woff3", "jsx", "gzip", "toolongext"};
+
+  for (const char* extension : unknown) {
+    TEST_ASSERT_NULL_MESSAGE(MimeTypes::Find(extension), extension);
+    TEST_ASSERT_EQUAL_STRING(MIME_TYPE_DEFAULT, MimeTypes::Get(extension));
+  }
+
+  TEST_ASSERT_NULL(MimeTypes::Find(nullptr));
+  TEST_ASSERT_NULL(MimeTypes::Find(""));
+  TEST_ASSERT_NULL(MimeTypes::Find("."));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_entry_is_found);
+  RUN_TEST(test_lookup_ignores_case);
+  RUN_TEST(test_unknown_extensions_miss);
+  return UNITY_END();
+}
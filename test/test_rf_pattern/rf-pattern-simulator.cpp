@@ -0,0 +1,72 @@
+#include "rf-pattern-simulator.hpp"
+
+#include "rf-scheduler.hpp"
+
+RfPatternSimulator::Report RfPatternSimulator::Run(const RfPattern& pattern, const Model& model) {
+  Report report = {};
+  if (pattern.empty()) {
+    return report;
+  }
+
+  RfScheduler scheduler;
+  scheduler.submit(pattern, 0, pattern.durationMs());
+
+  std::uint32_t random = model.seed != 0 ? model.seed : 1;
+  auto nextRandom      = [&random](std::uint32_t range) {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return range > 0 ? random % range : 0;
+  };
+
+  // Keyframe starts are numbered across loops, the first frame with a new number is that keyframe's start
+  std::uint32_t now      = 0;
+  std::uint32_t started  = 0;
+  std::uint32_t airEnd   = 0;  // When the transmitter finishes the last frame it was given
+  std::size_t nextStart  = 0;
+  std::uint64_t errorSum = 0;
+  while (scheduler.activeTargets() > 0) {
+    if (scheduler.next(now) != nullptr) {
+      std::uint32_t onAir = report.frames > 0 && static_cast<std::int32_t>(airEnd - now) > 0 ? airEnd : now;
+      airEnd              = onAir + RfScheduler::FRAME_MS;
+      if (report.frames == 0) {
+        started = onAir;
+      }
+
+      std::uint32_t elapsed = onAir - started;
+      std::uint32_t loop    = elapsed / pattern.periodMs();
+      std::size_t keyframe  = pattern.keyframeAt(elapsed);
+      std::size_t start     = loop * pattern.keyframeCount() + keyframe;
+
+      if (start >= nextStart) {
+        // Keyframes passed over without a frame, pauses have none to send
+        for (std::size_t skipped = nextStart; skipped < start; ++skipped) {
+          report.skipped += pattern.isPause(skipped % pattern.keyframeCount()) ? 0 : 1;
+        }
+
+        std::uint32_t error = elapsed - loop * pattern.periodMs() - pattern.keyframeStartMs(keyframe);
+        if (error > report.maxErrorMs) {
+          report.maxErrorMs = error;
+        }
+        errorSum += error;
+        report.keyframes++;
+        report.finalErrorMs = error;
+        nextStart           = start + 1;
+      }
+
+      report.frames++;
+      report.durationMs = elapsed + RfScheduler::FRAME_MS;
+    }
+
+    now += model.pollIntervalMs + nextRandom(model.jitterMs);
+    if (model.stallEveryMs > 0 && nextRandom(model.stallEveryMs) < model.pollIntervalMs) {
+      now += model.stallMs;
+    }
+  }
+
+  if (report.keyframes > 0) {
+    report.meanErrorMs = static_cast<std::uint32_t>(errorSum / report.keyframes);
+  }
+
+  return report;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "rf-pattern.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Plays a pattern through the RF scheduler the way WebServices::Update does, from a loop that runs late by a random
+// amount and stalls now and then, and measures when every keyframe's first frame goes out against the pattern's clock.
+// A frame goes out when the transmitter has finished the one before it, or right away if it's idle.
+// Used to check that late polls only delay a transition and never shift the rest of the pattern.
+class RfPatternSimulator {
+public:
+  struct Model {
+    std::uint32_t pollIntervalMs;  // Time between two loop() passes
+    std::uint32_t jitterMs;        // Additional random delay per pass, uniform in [0, jitterMs)
+    std::uint32_t stallEveryMs;    // Average time between long passes (WiFi, SD card), 0 for none
+    std::uint32_t stallMs;
+    std::uint32_t seed;
+  };
+
+  struct Report {
+    std::size_t frames;
+    std::size_t keyframes;       // Keyframe starts that got a frame on air
+    std::size_t skipped;         // Keyframe starts that never got one, pauses aren't counted
+    std::uint32_t durationMs;    // From the first frame to the end of the last one
+    std::uint32_t maxErrorMs;    // Largest delay of a keyframe's first frame after its nominal start
+    std::uint32_t meanErrorMs;
+    std::uint32_t finalErrorMs;  // Delay of the last keyframe start, how far the whole pattern drifted
+  };
+
+  static Report Run(const RfPattern& pattern, const Model& model);
+};
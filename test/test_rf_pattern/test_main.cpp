@@ -0,0 +1,147 @@
+#include "rf-pattern-simulator.hpp"
+#include "rf-pattern.hpp"
+#include "rf-scheduler.hpp"
+
+#include <unity.h>
+
+#include <cstdio>
+
+constexpr std::uint32_t FRAME_MS = RfScheduler::FRAME_MS;
+
+// Shock ramps up, holds, pauses and comes back as vibration, 4 keyframe starts per loop
+constexpr CollarKeyframe KEYFRAMES[] = {
+  {KeyframeShape::Ramp, Command::Shock, 40, 400},
+  {KeyframeShape::Hold, Command::Shock, 40, 300},
+  {KeyframeShape::Pause, Command::Shock, 0, 200},
+  {KeyframeShape::Hold, Command::Vibrate, 80, 300},
+};
+constexpr std::size_t KEYFRAME_COUNT = sizeof(KEYFRAMES) / sizeof(KEYFRAMES[0]);
+constexpr std::uint32_t PERIOD_MS    = 1200;
+
+RfPattern s_pattern;
+
+std::uint8_t strengthOf(const RfPattern::Frame* frame) {
+  CollarFrameFields fields {};
+  return frame != nullptr && RfPattern::Protocol::Decode(*frame, fields) ? fields.strength : 0;
+}
+
+void printReport(const char* name, const RfPatternSimulator::Report& report) {
+  char message[128];
+  std::snprintf(message,
+                sizeof(message),
+                "%s: %zu frames, %zu keyframes, %zu skipped, max %u ms, mean %u ms, final %u ms",
+                name,
+                report.frames,
+                report.keyframes,
+                report.skipped,
+                report.maxErrorMs,
+                report.meanErrorMs,
+                report.finalErrorMs);
+  TEST_MESSAGE(message);
+}
+
+void setUp() {
+  s_pattern.clear();
+}
+void tearDown() { }
+
+void test_ramp_steps_up_to_its_strength() {
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 1));
+  TEST_ASSERT_EQUAL_UINT32(PERIOD_MS, s_pattern.periodMs());
+
+  // 400 ms fit 9 frames, fewer than the 40 steps, so the ramp takes bigger ones
+  std::uint8_t previous = 0;
+  std::size_t steps     = 0;
+  for (std::uint32_t elapsed = 0; elapsed < 400; ++elapsed) {
+    std::uint8_t strength = strengthOf(s_pattern.frameAt(elapsed));
+    TEST_ASSERT_TRUE(strength >= previous);
+    if (strength > previous) {
+      steps++;
+    }
+    previous = strength;
+  }
+  TEST_ASSERT_EQUAL_UINT32(400 / FRAME_MS, steps);
+  TEST_ASSERT_EQUAL_UINT8(40, previous);
+  TEST_ASSERT_NULL(s_pattern.frameAt(800));
+  TEST_ASSERT_EQUAL_UINT8(80, strengthOf(s_pattern.frameAt(900)));
+  TEST_ASSERT_NULL(s_pattern.frameAt(PERIOD_MS));
+}
+
+void test_duration_is_capped() {
+  constexpr std::uint8_t MAX_LOOPS = RfPattern::MAX_DURATION_MS / PERIOD_MS;
+
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, MAX_LOOPS));
+  TEST_ASSERT_FALSE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, MAX_LOOPS + 1));
+  TEST_ASSERT_TRUE(s_pattern.empty());
+
+  // Repeating until stopped ends at the cap too, even if the client never stops it
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 0));
+  TEST_ASSERT_EQUAL_UINT32(RfPattern::MAX_DURATION_MS, s_pattern.durationMs());
+  TEST_ASSERT_NOT_NULL(s_pattern.frameAt(RfPattern::MAX_DURATION_MS - PERIOD_MS));
+  TEST_ASSERT_TRUE(s_pattern.finished(RfPattern::MAX_DURATION_MS));
+  TEST_ASSERT_NULL(s_pattern.frameAt(RfPattern::MAX_DURATION_MS));
+}
+
+void test_endless_pattern_leaves_scheduler_at_cap() {
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 0));
+
+  RfPatternSimulator::Report report = RfPatternSimulator::Run(s_pattern, {1, 0, 0, 0, 1});
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(RfPattern::MAX_DURATION_MS + FRAME_MS, report.durationMs);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(RfPattern::MAX_DURATION_MS - FRAME_MS, report.durationMs);
+}
+
+void test_prompt_polls_follow_the_pattern() {
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 5));
+
+  RfPatternSimulator::Report report = RfPatternSimulator::Run(s_pattern, {1, 0, 0, 0, 1});
+  printReport("Polled every ms", report);
+
+  // A transition waits at most for the frame already on air and the one queued behind it
+  TEST_ASSERT_EQUAL_UINT32(5 * (KEYFRAME_COUNT - 1), report.keyframes);
+  TEST_ASSERT_EQUAL_UINT32(0, report.skipped);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 * FRAME_MS, report.maxErrorMs);
+}
+
+void test_late_polls_dont_drift() {
+  constexpr RfPatternSimulator::Model model = {5, 20, 0, 0, 0xC0FFEE};
+  constexpr std::uint32_t maxDelayMs        = 2 * FRAME_MS + model.pollIntervalMs + model.jitterMs;
+
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 2));
+  RfPatternSimulator::Report shortRun = RfPatternSimulator::Run(s_pattern, model);
+  printReport("2 loops, late polls", shortRun);
+
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 45));
+  RfPatternSimulator::Report longRun = RfPatternSimulator::Run(s_pattern, model);
+  printReport("45 loops, late polls", longRun);
+
+  // Lateness never accumulates, the last keyframe of a long run is no later than one of a short run could be
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(maxDelayMs, shortRun.maxErrorMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(maxDelayMs, longRun.maxErrorMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(maxDelayMs, longRun.finalErrorMs);
+  TEST_ASSERT_EQUAL_UINT32(0, longRun.skipped);
+}
+
+void test_stalls_only_delay_a_transition() {
+  constexpr RfPatternSimulator::Model model = {5, 20, 2000, 250, 0xBEEF};
+  constexpr std::uint32_t maxDelayMs        = 2 * FRAME_MS + model.pollIntervalMs + model.jitterMs + model.stallMs;
+
+  TEST_ASSERT_TRUE(s_pattern.compile(0x1234, Channel::Channel1, KEYFRAMES, KEYFRAME_COUNT, 45));
+  RfPatternSimulator::Report report = RfPatternSimulator::Run(s_pattern, model);
+  printReport("45 loops, stalls", report);
+
+  // A stall may swallow a keyframe, the ones after it are back on time
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(maxDelayMs, report.maxErrorMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 * FRAME_MS + model.pollIntervalMs + model.jitterMs, report.meanErrorMs);
+  TEST_ASSERT_EQUAL_UINT32(45 * (KEYFRAME_COUNT - 1), report.keyframes + report.skipped);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_steps_up_to_its_strength);
+  RUN_TEST(test_duration_is_capped);
+  RUN_TEST(test_endless_pattern_leaves_scheduler_at_cap);
+  RUN_TEST(test_prompt_polls_follow_the_pattern);
+  RUN_TEST(test_late_polls_dont_drift);
+  RUN_TEST(test_stalls_only_delay_a_transition);
+  return UNITY_END();
+}
@@ -0,0 +1,54 @@
+#include "rf-pulse-simulator.hpp"
+
+RfPulseSimulator::Report
+  RfPulseSimulator::Run(const RfPulseTrain& train, std::uint16_t repeats, std::uint32_t gapUs, const Model& model) {
+  Report report = {};
+
+  RfPulsePlayer player;
+  player.begin(train, repeats, gapUs);
+
+  std::uint32_t random = model.seed != 0 ? model.seed : 1;
+
+  // All times in ns, the first edge is started directly by the transmitter and has no error
+  bool level;
+  std::uint32_t duration = player.next(level);
+  std::int64_t ideal     = 0;
+  std::int64_t actual    = 0;
+  std::uint64_t errorSum = 0;
+
+  while (duration != 0) {
+    std::int64_t ticks = static_cast<std::int64_t>(duration) * model.ticksPerUs - model.compensationTicks;
+    if (ticks < 1) {
+      ticks = 1;
+    }
+
+    std::uint32_t latency = model.latencyNs;
+    if (model.jitterNs > 0) {
+      random ^= random << 13;
+      random ^= random >> 17;
+      random ^= random << 5;
+      latency += random % model.jitterNs;
+    }
+
+    actual += ticks * 1000 / model.ticksPerUs + latency;
+    ideal += static_cast<std::int64_t>(duration) * 1000;
+    report.idealUs += duration;
+
+    std::int64_t error          = actual - ideal;
+    std::uint32_t absoluteError = static_cast<std::uint32_t>(error < 0 ? -error : error);
+    if (absoluteError > report.maxErrorNs) {
+      report.maxErrorNs = absoluteError;
+    }
+    errorSum += absoluteError;
+    report.edges++;
+    report.finalErrorNs = static_cast<std::int32_t>(error);
+
+    duration = player.next(level);
+  }
+
+  if (report.edges > 0) {
+    report.meanErrorNs = static_cast<std::uint32_t>(errorSum / report.edges);
+  }
+
+  return report;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "rf-pulse-train.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Replays a pulse train the way the transmitter's timer interrupt does and compares every edge with the ideal waveform.
+// Used to pick the latency compensation and to check that a timer configuration stays within the receiver's tolerance.
+class RfPulseSimulator {
+public:
+  struct Model {
+    std::uint32_t ticksPerUs;         // Timer resolution
+    std::uint32_t latencyNs;          // Timer expiry to the next timer write, on average
+    std::uint32_t jitterNs;           // Additional random latency, uniform in [0, jitterNs)
+    std::uint32_t compensationTicks;  // Subtracted from every programmed duration
+    std::uint32_t seed;
+  };
+
+  struct Report {
+    std::size_t edges;
+    std::uint32_t idealUs;
+    std::uint32_t maxErrorNs;   // Largest absolute edge error
+    std::uint32_t meanErrorNs;  // Mean absolute edge error
+    std::int32_t finalErrorNs;  // Error of the last edge, how far the whole transmission drifted
+  };
+
+  static Report Run(const RfPulseTrain& train, std::uint16_t repeats, std::uint32_t gapUs, const Model& model);
+};
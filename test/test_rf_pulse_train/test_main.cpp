@@ -0,0 +1,113 @@
+#include "rf-pulse-simulator.hpp"
+#include "rf-pulse-train.hpp"
+#include "rf-transmitter.hpp"
+#include "serializers/caixianlin-serialize.hpp"
+
+#include <unity.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+constexpr std::uint16_t CHIP_US      = 250;
+constexpr std::uint16_t REPEATS      = 5;
+constexpr std::uint32_t GAP_US       = 5000;
+constexpr std::uint32_t TICK_NS      = 1000 / RfTransmitter::TIMER_TICKS_PER_US;
+constexpr std::uint32_t JITTER_NS    = 500;
+constexpr std::uint32_t TOLERANCE_NS = CHIP_US * 1000 / 10;  // Far inside what the receiver accepts per edge
+
+// Interrupt entry to timer write on the device, deliberately not taken from TIMER_LATENCY_TICKS and not a whole number
+// of ticks, so the compensation is checked against a latency it doesn't define itself
+constexpr std::uint32_t ISR_LATENCY_NS = 2060;
+
+RfPulseTrain s_train;
+
+void setUp() {
+  std::array<std::byte, CAIXIANLIN_FRAME_SIZE> frame = MakeCaiXianlinFrame(0x1234, Channel::Channel2, Command::Vibrate, 50);
+  TEST_ASSERT_TRUE(s_train.build(frame.data(), frame.size(), CHIP_US));
+}
+void tearDown() { }
+
+void printReport(const char* name, const RfPulseSimulator::Report& report) {
+  char message[128];
+  std::snprintf(message,
+                sizeof(message),
+                "%s: %zu edges, max %u ns, mean %u ns, final %d ns",
+                name,
+                report.edges,
+                report.maxErrorNs,
+                report.meanErrorNs,
+                report.finalErrorNs);
+  TEST_MESSAGE(message);
+}
+
+void test_train_matches_frame() {
+  // Every chip of the frame is in exactly one pulse, and levels alternate starting with carrier on
+  TEST_ASSERT_EQUAL_UINT32(CAIXIANLIN_FRAME_SIZE * 8 * CHIP_US, s_train.totalUs());
+  for (std::size_t i = 0; i < s_train.count(); ++i) {
+    TEST_ASSERT_EQUAL_UINT32(0, s_train.durationUs(i) % CHIP_US);
+  }
+  TEST_ASSERT_EQUAL_UINT16(6 * CHIP_US, s_train.durationUs(0));  // Sync
+}
+
+void test_player_repeats_with_gap() {
+  RfPulseSimulator::Report report = RfPulseSimulator::Run(s_train, REPEATS, GAP_US, {1, 0, 0, 0, 1});
+
+  TEST_ASSERT_EQUAL_UINT32(REPEATS * s_train.totalUs() + (REPEATS - 1) * GAP_US, report.idealUs);
+  TEST_ASSERT_EQUAL_UINT32(0, report.maxErrorNs);
+  TEST_ASSERT_EQUAL_INT32(0, report.finalErrorNs);
+}
+
+void test_uncompensated_latency_drifts() {
+  RfPulseSimulator::Report report =
+    RfPulseSimulator::Run(s_train, REPEATS, GAP_US, {RfTransmitter::TIMER_TICKS_PER_US, ISR_LATENCY_NS, 0, 0, 1});
+  printReport("Uncompensated", report);
+
+  // Every edge adds the interrupt latency, the error grows with the length of the transmission
+  TEST_ASSERT_EQUAL_INT32(static_cast<std::int32_t>(report.edges * ISR_LATENCY_NS), report.finalErrorNs);
+}
+
+void test_compensation_cancels_latency() {
+  RfPulseSimulator::Model model = {
+    RfTransmitter::TIMER_TICKS_PER_US, ISR_LATENCY_NS, 0, RfTransmitter::TIMER_LATENCY_TICKS, 1};
+
+  // The compensation can only round the latency to whole ticks, every edge may be off by up to half a tick more
+  // than the previous one, and no edge of a frame may leave the tolerance
+  RfPulseSimulator::Report frame = RfPulseSimulator::Run(s_train, 1, 0, model);
+  printReport("Compensated frame", frame);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(frame.edges * (TICK_NS / 2), frame.maxErrorNs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(TOLERANCE_NS, frame.maxErrorNs);
+
+  RfPulseSimulator::Report burst = RfPulseSimulator::Run(s_train, REPEATS, GAP_US, model);
+  printReport("Compensated burst", burst);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(burst.edges * (TICK_NS / 2), burst.maxErrorNs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(burst.edges * (TICK_NS / 2), static_cast<std::uint32_t>(std::abs(burst.finalErrorNs)));
+}
+
+void test_jitter_stays_within_tolerance() {
+  // Latency varies around the interrupt latency
+  RfPulseSimulator::Model model = {RfTransmitter::TIMER_TICKS_PER_US,
+                                   ISR_LATENCY_NS - JITTER_NS / 2,
+                                   JITTER_NS,
+                                   RfTransmitter::TIMER_LATENCY_TICKS,
+                                   0xC0FFEE};
+
+  RfPulseSimulator::Report frame = RfPulseSimulator::Run(s_train, 1, 0, model);
+  printReport("One frame with jitter", frame);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(TOLERANCE_NS, frame.maxErrorNs);
+
+  // The receiver syncs on every frame, over a burst only the rounding of the compensation adds up, the jitter averages out
+  RfPulseSimulator::Report burst = RfPulseSimulator::Run(s_train, REPEATS, GAP_US, model);
+  printReport("Burst with jitter", burst);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(burst.edges * (TICK_NS / 2), burst.maxErrorNs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(burst.edges * (TICK_NS / 2), static_cast<std::uint32_t>(std::abs(burst.finalErrorNs)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_train_matches_frame);
+  RUN_TEST(test_player_repeats_with_gap);
+  RUN_TEST(test_uncompensated_latency_drifts);
+  RUN_TEST(test_compensation_cancels_latency);
+  RUN_TEST(test_jitter_stays_within_tolerance);
+  return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#include "rf-scheduler.hpp"
+
+#include <unity.h>
+
+#include <cstdio>
+#include <optional>
+
+using Protocol = RfScheduler::Protocol;
+
+constexpr std::uint32_t FRAME_MS = RfScheduler::FRAME_MS;
+constexpr std::uint16_t NO_FRAME = 0;
+
+// Fake clock, the scheduler never reads the time by itself
+std::uint32_t s_now = 0;
+
+std::optional<RfScheduler> s_scheduler;
+
+CollarCommand command(std::uint16_t transmitterId, Command action, std::uint16_t durationMs) {
+  return {CollarAction::Transmit, transmitterId, Channel::Channel1, action, 50, durationMs};
+}
+
+// Transmitter ID the frame was encoded for
+std::uint16_t idOf(const RfScheduler::Frame* frame) {
+  CollarFrameFields fields {};
+  return frame != nullptr && Protocol::Decode(*frame, fields) ? fields.transmitterId : NO_FRAME;
+}
+
+std::uint16_t next() {
+  return idOf(s_scheduler->next(s_now));
+}
+
+void setUp() {
+  s_now = 1000;
+  s_scheduler.emplace();
+}
+void tearDown() { }
+
+void test_one_frame_waits_behind_the_one_on_air() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 1000), s_now, 100));
+
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(NO_FRAME, next());
+
+  // Nothing more until the first frame has ended and the queued one is on air
+  s_now += FRAME_MS - 1;
+  TEST_ASSERT_EQUAL_UINT16(NO_FRAME, next());
+  s_now += 1;
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT32(3, s_scheduler->stats().framesSent);
+}
+
+void test_earliest_deadline_goes_first() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 0), s_now, 300));
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(2, Command::Shock, 0), s_now, 100));
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(3, Command::Beep, 0), s_now, 200));
+
+  TEST_ASSERT_EQUAL_UINT16(2, next());
+  TEST_ASSERT_EQUAL_UINT16(3, next());
+  s_now += FRAME_MS;
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+
+  // Each got its single frame and is done once it has been on air
+  s_now += 2 * FRAME_MS;
+  TEST_ASSERT_EQUAL_UINT16(NO_FRAME, next());
+  TEST_ASSERT_EQUAL_UINT32(3, s_scheduler->stats().completed);
+  TEST_ASSERT_EQUAL_UINT32(0, s_scheduler->stats().expired);
+}
+
+void test_deadline_is_judged_at_frame_start() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 500), s_now, 10));
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(2, Command::Shock, 500), s_now, FRAME_MS - 1));
+
+  // The second command's frame could only start after its deadline, behind the first one
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->stats().expired);
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->activeTargets());
+}
+
+void test_running_targets_take_turns() {
+  constexpr std::uint32_t LONG_MS  = 1000;
+  constexpr std::uint32_t SHORT_MS = 200;
+
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, LONG_MS), s_now, 100));
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(2, Command::Shock, SHORT_MS), s_now, 100));
+
+  // Polled every millisecond, the way loop() would, with both collars sharing the radio
+  std::uint32_t start    = s_now;
+  std::uint32_t frames[] = {0, 0, 0};
+  std::uint16_t previous = NO_FRAME;
+  std::uint32_t lastEnd  = 0;
+  for (; s_now - start < 2 * LONG_MS; ++s_now) {
+    std::uint16_t id = next();
+    if (id == NO_FRAME) {
+      continue;
+    }
+
+    frames[id]++;
+    if (s_scheduler->activeTargets() == 2 && id == previous) {
+      char message[64];
+      std::snprintf(message, sizeof(message), "Collar %u got two frames in a row at %u ms", id, s_now - start);
+      TEST_FAIL_MESSAGE(message);
+    }
+    previous = id;
+    lastEnd  = s_now - start + 2 * FRAME_MS;
+  }
+
+  // The short command got every other frame for its duration, the long one kept going afterwards
+  TEST_ASSERT_UINT32_WITHIN(1, SHORT_MS / FRAME_MS / 2 + 1, frames[2]);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(LONG_MS / FRAME_MS - frames[2], frames[1]);
+  TEST_ASSERT_UINT32_WITHIN(2 * FRAME_MS, LONG_MS, lastEnd);
+  TEST_ASSERT_EQUAL_UINT32(2, s_scheduler->stats().completed);
+}
+
+void test_new_command_jumps_the_rotation() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 1000), s_now, 100));
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(2, Command::Vibrate, 1000), s_now, 100));
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(2, next());
+
+  s_now += FRAME_MS;
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(3, Command::Shock, 100), s_now, 100));
+  TEST_ASSERT_EQUAL_UINT16(3, next());
+  s_now += FRAME_MS;
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+}
+
+void test_stop_preempts_frames_on_air_and_queued() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 1000), s_now, 100));
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(2, Command::Vibrate, 1000), s_now, 100));
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(2, next());
+
+  // The queued frame counts too, stopping the radio drops it
+  s_now += FRAME_MS / 2;
+  TEST_ASSERT_TRUE(s_scheduler->stop(2, Channel::Channel1, s_now));
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->stats().preempted);
+
+  // The other collar gets the idle radio right away
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+
+  s_now += FRAME_MS / 2;
+  TEST_ASSERT_TRUE(s_scheduler->stop(1, Channel::Channel1, s_now));
+  TEST_ASSERT_FALSE(s_scheduler->stop(1, Channel::Channel1, s_now));
+}
+
+void test_stop_after_frame_ended_keeps_radio() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 1000), s_now, 100));
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+
+  s_now += FRAME_MS;
+  TEST_ASSERT_FALSE(s_scheduler->stop(1, Channel::Channel1, s_now));
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->stats().stopped);
+  TEST_ASSERT_EQUAL_UINT32(0, s_scheduler->stats().preempted);
+}
+
+void test_unsend_takes_the_frame_back() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 100), s_now, 50));
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  s_scheduler->unsend();
+
+  TEST_ASSERT_EQUAL_UINT32(0, s_scheduler->stats().framesSent);
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->stats().framesFailed);
+
+  // Still waiting for its first frame, the radio is free for it and the deadline still applies
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  s_scheduler->unsend();
+  s_now += 51;
+  TEST_ASSERT_EQUAL_UINT16(NO_FRAME, next());
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->stats().expired);
+}
+
+void test_unsend_keeps_running_command() {
+  TEST_ASSERT_TRUE(s_scheduler->submit(command(1, Command::Vibrate, 1000), s_now, 50));
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  s_scheduler->unsend();
+
+  // Only the refused frame is taken back, the one on air still blocks the radio until it ends
+  TEST_ASSERT_EQUAL_UINT32(1, s_scheduler->stats().framesSent);
+  TEST_ASSERT_EQUAL_UINT16(1, next());
+  TEST_ASSERT_EQUAL_UINT16(NO_FRAME, next());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_frame_waits_behind_the_one_on_air);
+  RUN_TEST(test_earliest_deadline_goes_first);
+  RUN_TEST(test_deadline_is_judged_at_frame_start);
+  RUN_TEST(test_running_targets_take_turns);
+  RUN_TEST(test_new_command_jumps_the_rotation);
+  RUN_TEST(test_stop_preempts_frames_on_air_and_queued);
+  RUN_TEST(test_stop_after_frame_ended_keeps_radio);
+  RUN_TEST(test_unsend_takes_the_frame_back);
+  RUN_TEST(test_unsend_keeps_running_command);
+  return UNITY_END();
+}
@@ -0,0 +1,232 @@
+#include "ws-protocol.hpp"
+
+#include <unity.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+
+using Opcode = WsProtocol::Opcode;
+using Status = WsProtocol::Status;
+
+// Builds a command frame the way a client does
+std::array<std::uint8_t, WsProtocol::COMMAND_SIZE> EncodeCommand(std::uint16_t sequence,
+                                                                 std::uint16_t transmitterId,
+                                                                 std::uint8_t channel,
+                                                                 std::uint8_t command,
+                                                                 std::uint8_t strength,
+                                                                 std::uint16_t durationMs) {
+  std::array<std::uint8_t, WsProtocol::COMMAND_SIZE> frame {};
+  frame[0] = WsProtocol::VERSION;
+  frame[1] = static_cast<std::uint8_t>(Opcode::Command);
+  WsProtocol::WriteU16(frame.data() + 2, sequence);
+  WsProtocol::WriteU16(frame.data() + 4, transmitterId);
+  frame[6] = channel;
+  frame[7] = command;
+  frame[8] = strength;
+  WsProtocol::WriteU16(frame.data() + 9, durationMs);
+  return frame;
+}
+
+std::uint32_t Xorshift32(std::uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_command_round_trip() {
+  std::uint32_t seed = 0x2545F491;
+
+  for (int i = 0; i < 100'000; ++i) {
+    std::uint32_t a = Xorshift32(seed);
+    std::uint32_t b = Xorshift32(seed);
+
+    std::uint16_t sequence      = static_cast<std::uint16_t>(a);
+    std::uint16_t transmitterId = static_cast<std::uint16_t>(a >> 16);
+    std::uint8_t channel        = b % 3;
+    std::uint8_t command        = 1 + (b >> 2) % 3;
+    std::uint8_t strength       = (b >> 4) % 100;
+    std::uint16_t durationMs    = static_cast<std::uint16_t>(b >> 16);
+
+    auto frame = EncodeCommand(sequence, transmitterId, channel, command, strength, durationMs);
+
+    WsProtocol::Message message {};
+    TEST_ASSERT_TRUE(WsProtocol::Decode(frame.data(), frame.size(), message) == Status::Ok);
+    TEST_ASSERT_TRUE(message.opcode == Opcode::Command);
+    TEST_ASSERT_EQUAL_UINT16(sequence, message.sequence);
+    TEST_ASSERT_TRUE(message.command.action == CollarAction::Transmit);
+    TEST_ASSERT_EQUAL_UINT16(transmitterId, message.command.transmitterId);
+    TEST_ASSERT_EQUAL_UINT8(channel, static_cast<std::uint8_t>(message.command.channel));
+    TEST_ASSERT_EQUAL_UINT8(command, static_cast<std::uint8_t>(message.command.command));
+    TEST_ASSERT_EQUAL_UINT8(strength, message.command.strength);
+    TEST_ASSERT_EQUAL_UINT16(durationMs, message.command.durationMs);
+  }
+}
+
+void test_command_fields_are_little_endian() {
+  constexpr std::uint8_t frame[] = {0x01, 0x01, 0x34, 0x12, 0xCD, 0xAB, 0x02, 0x03, 0x63, 0xE8, 0x03};
+
+  WsProtocol::Message message {};
+  TEST_ASSERT_TRUE(WsProtocol::Decode(frame, sizeof(frame), message) == Status::Ok);
+  TEST_ASSERT_EQUAL_UINT16(0x1234, message.sequence);
+  TEST_ASSERT_EQUAL_UINT16(0xABCD, message.command.transmitterId);
+  TEST_ASSERT_TRUE(message.command.channel == Channel::Channel3);
+  TEST_ASSERT_TRUE(message.command.command == Command::Beep);
+  TEST_ASSERT_EQUAL_UINT8(99, message.command.strength);
+  TEST_ASSERT_EQUAL_UINT16(1000, message.command.durationMs);
+}
+
+void test_rejected_frames_keep_their_sequence() {
+  WsProtocol::Message message {};
+
+  auto frame = EncodeCommand(0x0102, 0x1234, 1, 2, 50, 500);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(frame.data(), WsProtocol::HEADER_SIZE - 1, message) == Status::Malformed);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(frame.data(), frame.size() - 1, message) == Status::Malformed);
+  TEST_ASSERT_EQUAL_UINT16(0x0102, message.sequence);
+
+  frame[0] = WsProtocol::VERSION + 1;
+  TEST_ASSERT_TRUE(WsProtocol::Decode(frame.data(), frame.size(), message) == Status::UnsupportedVersion);
+  TEST_ASSERT_EQUAL_UINT16(0x0102, message.sequence);
+
+  frame    = EncodeCommand(0x0203, 0x1234, 1, 2, 50, 500);
+  frame[1] = 0x7F;
+  TEST_ASSERT_TRUE(WsProtocol::Decode(frame.data(), frame.size(), message) == Status::UnknownOpcode);
+  TEST_ASSERT_EQUAL_UINT16(0x0203, message.sequence);
+
+  // Device to client opcodes are not accepted from a client
+  frame[1] = static_cast<std::uint8_t>(Opcode::Ack);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(frame.data(), frame.size(), message) == Status::UnknownOpcode);
+}
+
+void test_out_of_range_commands_are_invalid() {
+  WsProtocol::Message message {};
+
+  auto channel  = EncodeCommand(1, 0x1234, 3, 2, 50, 500);
+  auto command  = EncodeCommand(1, 0x1234, 1, 0, 50, 500);
+  auto command4 = EncodeCommand(1, 0x1234, 1, 4, 50, 500);
+  auto strength = EncodeCommand(1, 0x1234, 1, 2, 100, 500);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(channel.data(), channel.size(), message) == Status::InvalidCommand);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(command.data(), command.size(), message) == Status::InvalidCommand);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(command4.data(), command4.size(), message) == Status::InvalidCommand);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(strength.data(), strength.size(), message) == Status::InvalidCommand);
+}
+
+void test_stop_and_subscription_frames() {
+  WsProtocol::Message message {};
+
+  constexpr std::uint8_t stop[] = {0x01, 0x02, 0x05, 0x00, 0x34, 0x12, 0x01};
+  TEST_ASSERT_TRUE(WsProtocol::Decode(stop, sizeof(stop), message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.command.action == CollarAction::Stop);
+  TEST_ASSERT_EQUAL_UINT16(0x1234, message.command.transmitterId);
+  TEST_ASSERT_TRUE(message.command.channel == Channel::Channel2);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(stop, sizeof(stop) - 1, message) == Status::Malformed);
+
+  constexpr std::uint8_t subscribe[]   = {0x01, 0x03, 0x06, 0x00};
+  constexpr std::uint8_t unsubscribe[] = {0x01, 0x04, 0x07, 0x00, 0x00};
+  TEST_ASSERT_TRUE(WsProtocol::Decode(subscribe, sizeof(subscribe), message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.opcode == Opcode::Subscribe);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(unsubscribe, sizeof(unsubscribe), message) == Status::Malformed);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(unsubscribe, WsProtocol::HEADER_SIZE, message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.opcode == Opcode::Unsubscribe);
+}
+
+void test_pattern_frames() {
+  WsProtocol::Message message {};
+
+  // Ramp to 40 over 1 s, pause 250 ms, hold 20 for 500 ms, 3 loops
+  constexpr std::uint8_t pattern[] = {
+    0x01, 0x05, 0x08, 0x00, 0x34, 0x12, 0x00, 0x03, 0x03,  //
+    0x12, 0x28, 0xE8, 0x03,                                //
+    0x20, 0x00, 0xFA, 0x00,                                //
+    0x01, 0x14, 0xF4, 0x01,
+  };
+  TEST_ASSERT_TRUE(WsProtocol::Decode(pattern, sizeof(pattern), message) == Status::Ok);
+  TEST_ASSERT_TRUE(message.command.action == CollarAction::Pattern);
+  TEST_ASSERT_EQUAL_UINT8(3, message.patternLoops);
+  TEST_ASSERT_EQUAL_UINT8(3, message.keyframeCount);
+  TEST_ASSERT_TRUE(message.keyframes == pattern + WsProtocol::PATTERN_HEADER_SIZE);
+  TEST_ASSERT_TRUE(message.command.command == Command::Vibrate);
+  TEST_ASSERT_EQUAL_UINT8(40, message.command.strength);
+
+  CollarKeyframe pause = WsProtocol::ReadKeyframe(message.keyframes + WsProtocol::KEYFRAME_SIZE);
+  TEST_ASSERT_TRUE(pause.shape == KeyframeShape::Pause);
+  TEST_ASSERT_EQUAL_UINT16(250, pause.durationMs);
+
+  // The keyframe count has to match the length
+  TEST_ASSERT_TRUE(WsProtocol::Decode(pattern, sizeof(pattern) - 1, message) == Status::Malformed);
+  TEST_ASSERT_TRUE(WsProtocol::Decode(pattern, WsProtocol::PATTERN_HEADER_SIZE - 1, message) == Status::Malformed);
+
+  // A pattern can't start with a pause
+  std::array<std::uint8_t, sizeof(pattern)> invalid {};
+  std::copy(std::begin(pattern), std::end(pattern), invalid.begin());
+  invalid[9] = 0x22;
+  TEST_ASSERT_TRUE(WsProtocol::Decode(invalid.data(), invalid.size(), message) == Status::InvalidCommand);
+
+  // Nor hold a zero length keyframe
+  std::copy(std::begin(pattern), std::end(pattern), invalid.begin());
+  invalid[19] = 0x00;
+  invalid[20] = 0x00;
+  TEST_ASSERT_TRUE(WsProtocol::Decode(invalid.data(), invalid.size(), message) == Status::InvalidCommand);
+}
+
+void test_ack_encoding() {
+  std::array<std::uint8_t, WsProtocol::ACK_SIZE> ack;
+  ack.fill(0xFF);
+
+  WsProtocol::EncodeAck(0xBEEF, Status::QueueFull, ack);
+  constexpr std::uint8_t expected[WsProtocol::ACK_SIZE] = {0x01, 0x81, 0xEF, 0xBE, 0x06};
+  TEST_ASSERT_EQUAL_MEMORY(expected, ack.data(), WsProtocol::ACK_SIZE);
+
+  // An ack carries the header of the frame it answers
+  auto frame = EncodeCommand(0x4321, 0x1234, 0, 1, 10, 100);
+  WsProtocol::Message message {};
+  Status status = WsProtocol::Decode(frame.data(), frame.size(), message);
+  WsProtocol::EncodeAck(message.sequence, status, ack);
+  TEST_ASSERT_EQUAL_UINT8(WsProtocol::VERSION, ack[0]);
+  TEST_ASSERT_EQUAL_UINT8(static_cast<std::uint8_t>(Opcode::Ack), ack[1]);
+  TEST_ASSERT_EQUAL_UINT16(0x4321, WsProtocol::ReadU16(ack.data() + 2));
+  TEST_ASSERT_EQUAL_UINT8(static_cast<std::uint8_t>(Status::Ok), ack[4]);
+}
+
+void test_benchmark() {
+  constexpr std::uint32_t FRAMES = 2'000'000;
+
+  auto frame         = EncodeCommand(1, 0x1234, 1, 2, 50, 500);
+  std::uint32_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < FRAMES; ++i) {
+    frame[8] = static_cast<std::uint8_t>(i % 100);
+
+    WsProtocol::Message message {};
+    sink += static_cast<std::uint32_t>(WsProtocol::Decode(frame.data(), frame.size(), message)) + message.command.strength;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Keeps the loop from being optimized away
+  volatile std::uint32_t result = sink;
+  (void)result;
+
+  char message[64];
+  std::snprintf(message, sizeof(message), "Command decode %.1f ns/frame",
+                std::chrono::duration<double, std::nano>(elapsed).count() / FRAMES);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_command_round_trip);
+  RUN_TEST(test_command_fields_are_little_endian);
+  RUN_TEST(test_rejected_frames_keep_their_sequence);
+  RUN_TEST(test_out_of_range_commands_are_invalid);
+  RUN_TEST(test_stop_and_subscription_frames);
+  RUN_TEST(test_pattern_frames);
+  RUN_TEST(test_ack_encoding);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
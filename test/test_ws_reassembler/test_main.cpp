@@ -0,0 +1,157 @@
+#include "ws-reassembler.hpp"
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using Result = WsReassembler::Result;
+
+// Feeds a message as fragments of at most fragmentSize bytes, returns the result of the last one
+Result Feed(WsReassembler& reassembler,
+            std::uint8_t clientId,
+            const std::uint8_t* data,
+            std::size_t length,
+            std::size_t fragmentSize,
+            std::uint32_t now,
+            WsReassembler::Message& message) {
+  std::size_t first = length < fragmentSize ? length : fragmentSize;
+  Result result     = reassembler.begin(clientId, false, data, first, now);
+
+  for (std::size_t offset = first; offset < length; offset += fragmentSize) {
+    std::size_t size = length - offset < fragmentSize ? length - offset : fragmentSize;
+    result           = reassembler.append(clientId, data + offset, size, offset + size == length, now, message);
+  }
+
+  return result;
+}
+
+void FillPattern(std::uint8_t* data, std::size_t length, std::uint8_t seed) {
+  for (std::size_t i = 0; i < length; ++i) {
+    data[i] = static_cast<std::uint8_t>(seed + i * 31);
+  }
+}
+
+WsReassembler s_reassembler;
+std::uint8_t s_upload[WsReassembler::MAX_MESSAGE_SIZE + 1];
+
+void setUp() {
+  s_reassembler = WsReassembler();
+  FillPattern(s_upload, sizeof(s_upload), 7);
+}
+void tearDown() { }
+
+void test_upload_larger_than_a_command() {
+  constexpr std::size_t UPLOAD_SIZE = WsReassembler::MAX_MESSAGE_SIZE - 5;
+  static_assert(UPLOAD_SIZE > JsonCommandParser::MAX_MESSAGE_SIZE * 4, "Upload has to span several command sizes");
+
+  WsReassembler::Message message {};
+  TEST_ASSERT_TRUE(Feed(s_reassembler, 1, s_upload, UPLOAD_SIZE, 125, 0, message) == Result::Complete);
+  TEST_ASSERT_FALSE(message.binary);
+  TEST_ASSERT_EQUAL_UINT32(UPLOAD_SIZE, message.length);
+  TEST_ASSERT_EQUAL_MEMORY(s_upload, message.data, UPLOAD_SIZE);
+  s_reassembler.release(1);
+
+  // A message of exactly the maximum size fits too
+  TEST_ASSERT_TRUE(Feed(s_reassembler, 1, s_upload, WsReassembler::MAX_MESSAGE_SIZE, 512, 0, message) == Result::Complete);
+  TEST_ASSERT_EQUAL_UINT32(WsReassembler::MAX_MESSAGE_SIZE, message.length);
+  TEST_ASSERT_EQUAL_MEMORY(s_upload, message.data, WsReassembler::MAX_MESSAGE_SIZE);
+  s_reassembler.release(1);
+
+  TEST_ASSERT_EQUAL_UINT32(2, s_reassembler.stats().completed);
+}
+
+void test_interleaved_clients_keep_their_messages_apart() {
+  static_assert(WsReassembler::POOL_SIZE >= 2, "Two clients need a buffer each");
+
+  std::uint8_t other[600];
+  FillPattern(other, sizeof(other), 99);
+
+  WsReassembler::Message message {};
+  TEST_ASSERT_TRUE(s_reassembler.begin(0, false, s_upload, 300, 0) == Result::Pending);
+  TEST_ASSERT_TRUE(s_reassembler.begin(1, true, other, 300, 0) == Result::Pending);
+  TEST_ASSERT_TRUE(s_reassembler.append(0, s_upload + 300, 300, false, 0, message) == Result::Pending);
+  TEST_ASSERT_TRUE(s_reassembler.append(1, other + 300, 300, true, 0, message) == Result::Complete);
+  TEST_ASSERT_TRUE(message.binary);
+  TEST_ASSERT_EQUAL_MEMORY(other, message.data, sizeof(other));
+  s_reassembler.release(1);
+
+  TEST_ASSERT_TRUE(s_reassembler.append(0, s_upload + 600, 400, true, 0, message) == Result::Complete);
+  TEST_ASSERT_EQUAL_UINT32(1000, message.length);
+  TEST_ASSERT_EQUAL_MEMORY(s_upload, message.data, 1000);
+}
+
+void test_oversize_message_is_dropped_and_skipped() {
+  WsReassembler::Message message {};
+
+  TEST_ASSERT_TRUE(s_reassembler.begin(2, false, s_upload, WsReassembler::MAX_MESSAGE_SIZE, 0) == Result::Pending);
+  TEST_ASSERT_TRUE(s_reassembler.append(2, s_upload, 1, false, 0, message) == Result::Dropped);
+  TEST_ASSERT_TRUE(s_reassembler.append(2, s_upload, 100, false, 0, message) == Result::Skipped);
+  TEST_ASSERT_TRUE(s_reassembler.append(2, s_upload, 100, true, 0, message) == Result::Skipped);
+  TEST_ASSERT_EQUAL_UINT32(1, s_reassembler.stats().droppedOversize);
+
+  // The buffer is free again and the next message is reassembled
+  TEST_ASSERT_TRUE(Feed(s_reassembler, 2, s_upload, 400, 100, 0, message) == Result::Complete);
+  TEST_ASSERT_EQUAL_MEMORY(s_upload, message.data, 400);
+
+  // A first fragment that alone is too long never takes a buffer
+  TEST_ASSERT_TRUE(s_reassembler.begin(3, false, s_upload, WsReassembler::MAX_MESSAGE_SIZE + 1, 0) == Result::Dropped);
+  TEST_ASSERT_TRUE(s_reassembler.append(3, s_upload, 10, true, 0, message) == Result::Skipped);
+}
+
+void test_pool_exhaustion_and_timeout() {
+  WsReassembler::Message message {};
+
+  for (std::uint8_t client = 0; client < WsReassembler::POOL_SIZE; ++client) {
+    TEST_ASSERT_TRUE(s_reassembler.begin(client, false, s_upload, 10, 0) == Result::Pending);
+  }
+  TEST_ASSERT_TRUE(s_reassembler.begin(WsReassembler::POOL_SIZE, false, s_upload, 10, 0) == Result::Dropped);
+  TEST_ASSERT_EQUAL_UINT32(1, s_reassembler.stats().droppedNoBuffer);
+
+  // Partial messages expire, a disconnect frees the buffer right away
+  s_reassembler.drop(0);
+  TEST_ASSERT_TRUE(s_reassembler.append(0, s_upload, 10, true, 0, message) == Result::Dropped);
+  s_reassembler.expire(WsReassembler::TIMEOUT_MS);
+  TEST_ASSERT_EQUAL_UINT32(0, s_reassembler.stats().droppedTimeout);
+  s_reassembler.expire(WsReassembler::TIMEOUT_MS + 1);
+  TEST_ASSERT_EQUAL_UINT32(WsReassembler::POOL_SIZE - 1, s_reassembler.stats().droppedTimeout);
+
+  TEST_ASSERT_TRUE(Feed(s_reassembler, 4, s_upload, 1000, 250, 5000, message) == Result::Complete);
+}
+
+void test_benchmark() {
+  constexpr std::uint32_t MESSAGES  = 20'000;
+  constexpr std::size_t UPLOAD_SIZE = 1500;
+  constexpr std::size_t FRAGMENT    = 128;
+
+  WsReassembler::Message message {};
+  std::uint32_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < MESSAGES; ++i) {
+    Feed(s_reassembler, i % 4, s_upload, UPLOAD_SIZE, FRAGMENT, i, message);
+    sink += message.data[UPLOAD_SIZE - 1];
+    s_reassembler.release(i % 4);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Keeps the loop from being optimized away
+  volatile std::uint32_t result = sink;
+  (void)result;
+
+  char text[80];
+  std::snprintf(text, sizeof(text), "%u byte upload in %u byte fragments %.2f us/message", static_cast<unsigned>(UPLOAD_SIZE),
+                static_cast<unsigned>(FRAGMENT), std::chrono::duration<double, std::micro>(elapsed).count() / MESSAGES);
+  TEST_MESSAGE(text);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_upload_larger_than_a_command);
+  RUN_TEST(test_interleaved_clients_keep_their_messages_apart);
+  RUN_TEST(test_oversize_message_is_dropped_and_skipped);
+  RUN_TEST(test_pool_exhaustion_and_timeout);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}